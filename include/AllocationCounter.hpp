@@ -0,0 +1,25 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Register one heap allocation, called by allocation hooks
+ */
+void countAllocation();
+
+/**
+ * @brief      Get the number of heap allocations made so far
+ *
+ * The number is only maintained when the application links the allocation
+ * hooks (src/AllocationHooks.cpp), as the command line tool does. It stays
+ * zero otherwise.
+ *
+ * @return     The number of allocations
+ */
+size_t getAllocationCount();
+}
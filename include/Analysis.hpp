@@ -0,0 +1,61 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <string>
+#include "Options.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Parameters of the analyzer driver
+ */
+struct AnalyzeOptions
+{
+    /** Analyzer command, see runCommand() */
+    std::string command;
+    /** Verdict cache file, @c verdicts.fzv in the output folder if empty */
+    std::string cache;
+};
+
+/**
+ * @brief      Runs the analyzer on generated programs and variants, skipping
+ *             those whose verdict is already known.
+ *
+ * Programs are looked up in a persistent VerdictCache by the hash of their
+ * canonical form salted with the command, so a program which differs from
+ * an analyzed one only in names or in the spelling of literals is not
+ * analyzed again, in this run or in later ones.
+ */
+class Analysis
+{
+public:
+    /**
+     * @brief      Construct the driver
+     *
+     * @param      options  The options of the generator
+     * @param      seed     The seed, the same as used by the command line
+     */
+    Analysis(const Options &options, unsigned long long seed);
+    virtual ~Analysis() = default;
+    Analysis(const Analysis &rhs) = default;
+    Analysis &operator=(const Analysis &rhs) = default;
+
+    /**
+     * @brief      Generate the programs with their variants and analyze them
+     *
+     * Programs the analyzer fails on are reported and kept in @p path.
+     *
+     * @param      analyze  The analyzer parameters
+     * @param      path     The path to the folder for programs
+     *
+     * @return     @c false if the cache can't be opened
+     */
+    bool run(const AnalyzeOptions &analyze, const std::string &path);
+
+private:
+    Options            _options;
+    unsigned long long _seed;
+};
+}
@@ -0,0 +1,19 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+
+/**
+ * @brief      In-process analyzer entry point used by the fuzzing target.
+ *
+ * The analyzer linked into the fuzzing target implements the hook; when no
+ * analyzer is configured, a stub which ignores programs is linked instead.
+ *
+ * @param      data  The rendered program, not null-terminated
+ * @param      size  The size of the program
+ *
+ * @return     Ignored, reserved for future use
+ */
+extern "C" int FuzzyTestAnalyze(const char *data, size_t size);
@@ -0,0 +1,185 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Syntax.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Binary syntax tree file which is used in place once mapped.
+ *
+ * All fields are little-endian. Fields of the sections are as wide as the
+ * largest value they hold needs (1 to 4 bytes, given in the header), so
+ * records keep a fixed size and any node is reached in constant time:
+ *
+ *   header      "FZA\0", u16 version, u16 reserved, u8 offset width,
+ *               u8 value width, u8 child width, u8 node width, u32 nodes,
+ *               u32 strings, u32 children, u32 string bytes, u32 root,
+ *               u32 random state bytes, u32 reserved
+ *   offsets     (strings + 1) offsets, start of each string in the data
+ *   nodes       u8 kind, value string index, first child; the children of
+ *               a node end where the ones of the next node start
+ *   children    node index per child, all bits set for a null child
+ *   random      state of the random source after the tree was generated
+ *   data        string bytes, values are interned and not terminated
+ *
+ * Nodes are numbered in pre-order starting with the root, a node shared
+ * between several parents is stored once. Records are not varint-encoded
+ * since that would need an index built on open to reach a node, so the file
+ * stays somewhat larger than the rendered program.
+ */
+class AstFile
+{
+public:
+    /** Current version of the format */
+    static const uint16_t version = 2;
+    /** Index of a null child or of the root of an empty tree */
+    static const uint32_t none = 0xFFFFFFFF;
+
+    AstFile() = default;
+    AstFile(const AstFile &) = delete;
+    AstFile &operator=(const AstFile &) = delete;
+    ~AstFile();
+
+    /**
+     * @brief      Encode the tree
+     *
+     * @param      root    The root of the tree, may be @c nullptr
+     * @param      out     The output buffer the file is appended to
+     * @param      random  The state of the random source written by
+     *                     RandomSource::saveState(), may be empty
+     */
+    static void encode(const std::shared_ptr<Syntax> &root,
+                       std::string                   &out,
+                       const std::string             &random = std::string());
+
+    /**
+     * @brief      Write the tree into the file
+     *
+     * @param      root    The root of the tree
+     * @param      file    The file name
+     * @param      random  The state of the random source, may be empty
+     *
+     * @return     @c true on success
+     */
+    static bool save(const std::shared_ptr<Syntax> &root,
+                     const std::string             &file,
+                     const std::string             &random = std::string());
+
+    /**
+     * @brief      Map the file and check its structure
+     *
+     * @param      file  The file name
+     *
+     * @return     @c true if the file is a valid tree of a known version
+     */
+    bool open(const std::string &file);
+
+    /**
+     * @brief      Use the tree encoded in memory, the buffer is not copied
+     *             and must outlive the object
+     *
+     * @param      data  The encoded tree
+     * @param      size  The size of the encoded tree
+     *
+     * @return     @c true if the buffer is a valid tree of a known version
+     */
+    bool open(const char *data, size_t size);
+
+    /**
+     * @brief      Build the syntax tree, node values are copied once from
+     *             the interned strings
+     *
+     * @return     The root of the tree or @c nullptr if the tree is empty
+     */
+    std::shared_ptr<Syntax> load() const;
+
+    /**
+     * @brief      Get the state of the random source saved with the tree
+     *
+     * @param      length  The length of the state, @c 0 if there is none
+     *
+     * @return     The state to pass to RandomSource::restoreState()
+     */
+    const char *randomState(size_t &length) const;
+
+    /** @return    Index of the root node or AstFile::none */
+    uint32_t root() const;
+
+    /** @return    Number of nodes */
+    uint32_t nodeCount() const;
+
+    /**
+     * @brief      Get the kind of the node
+     *
+     * @param      node  The node index
+     *
+     * @return     The kind
+     */
+    SyntaxKind kind(uint32_t node) const;
+
+    /**
+     * @brief      Get the value of the node without copying it
+     *
+     * @param      node    The node index
+     * @param      length  The length of the value
+     *
+     * @return     The value, not null-terminated
+     */
+    const char *value(uint32_t node, size_t &length) const;
+
+    /**
+     * @brief      Get the number of children of the node
+     *
+     * @param      node  The node index
+     *
+     * @return     The number of children
+     */
+    uint32_t childCount(uint32_t node) const;
+
+    /**
+     * @brief      Get the child of the node
+     *
+     * @param      node   The node index
+     * @param      index  The index of the child
+     *
+     * @return     The node index of the child or AstFile::none
+     */
+    uint32_t child(uint32_t node, uint32_t index) const;
+
+private:
+    void close();
+    bool check() const;
+    uint32_t field(size_t offset, unsigned width = 4) const;
+    uint32_t first(uint32_t node) const;
+    size_t offsetsAt() const;
+    size_t nodesAt() const;
+    size_t nodeAt(uint32_t node) const;
+    size_t childrenAt() const;
+    size_t randomAt() const;
+    size_t dataAt() const;
+
+    const char *_data = nullptr;
+    size_t      _size = 0;
+    void       *_map = nullptr;
+    uint32_t    _nodes = 0;
+    uint32_t    _strings = 0;
+    uint32_t    _children = 0;
+    uint32_t    _bytes = 0;
+    uint32_t    _root = none;
+    uint32_t    _random = 0;
+    /* Widths of string offsets, value indices, first children and nodes */
+    unsigned    _offsetWidth = 4;
+    unsigned    _valueWidth = 4;
+    unsigned    _childWidth = 4;
+    unsigned    _nodeWidth = 4;
+    /* Node index standing for a null child */
+    uint32_t    _null = none;
+};
+}
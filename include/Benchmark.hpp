@@ -0,0 +1,75 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include "Options.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Parameters of the size sweep
+ */
+struct SweepOptions
+{
+    /** Analyzer command, see runCommand() */
+    std::string command;
+    /** Number of sizes for every program shape */
+    unsigned    steps = 8;
+    /** Ratio between two consecutive sizes */
+    double      factor = 2.0;
+    /** Number of analyzer runs for every program */
+    unsigned    repeat = 3;
+};
+
+/**
+ * @brief      Size sweep producing analyzer cost curves.
+ *
+ * Programs of several shapes are generated at a geometric series of sizes,
+ * the analyzer is run on each of them and the results are written to
+ * @c sweep.csv, while growth exponents fitted for every shape are written to
+ * @c sweep_fit.csv.
+ */
+class Benchmark
+{
+public:
+    /**
+     * @brief      Construct the benchmark
+     *
+     * @param      options  The base options of the generator
+     * @param      seed     The seed of the random generator
+     */
+    Benchmark(const Options &options, unsigned long long seed);
+    virtual ~Benchmark() = default;
+    Benchmark(const Benchmark &rhs) = default;
+    Benchmark &operator=(const Benchmark &rhs) = default;
+
+    /**
+     * @brief      Run the size sweep
+     *
+     * @param      sweep  The sweep parameters
+     * @param      path   The path to the folder where to put results
+     *
+     * @return     @c true on success, @c false otherwise
+     */
+    bool sweep(const SweepOptions &sweep, const std::string &path);
+
+    /**
+     * @brief      Fit the exponent @c k of @c y = c * x^k with least squares
+     *             in log-log space
+     *
+     * @param      x     The sizes
+     * @param      y     The costs
+     *
+     * @return     The exponent, @c 0 if there are not enough points
+     */
+    static double fitExponent(const std::vector<double> &x,
+                              const std::vector<double> &y);
+
+private:
+    Options            _options;
+    unsigned long long _seed;
+};
+}
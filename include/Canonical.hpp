@@ -0,0 +1,75 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Syntax.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      128-bit structural hash of a syntax tree
+ */
+struct TreeHash
+{
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    bool operator==(const TreeHash &rhs) const
+    {
+        return high == rhs.high && low == rhs.low;
+    }
+
+    bool operator!=(const TreeHash &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    /**
+     * @brief      Format the hash as 32 hexadecimal digits
+     *
+     * @return     The string
+     */
+    std::string toString() const;
+
+    /** Hasher for unordered containers */
+    struct Hasher
+    {
+        size_t operator()(const TreeHash &hash) const
+        {
+            return static_cast<size_t>(hash.low ^ hash.high);
+        }
+    };
+};
+
+/**
+ * @brief      Encode the tree in the canonical form
+ *
+ * Identifiers, function names and calls are renamed in the order they are
+ * first declared or used, so programs that differ only in names have the
+ * same form. Integer literals are respelled only where their C type stays:
+ * hexadecimal and octal ones in hexadecimal, decimal ones in decimal, with
+ * normalized suffixes. @c main and names not declared in the program
+ * keep their spelling.
+ *
+ * @param      root  The root of the tree
+ * @param      out   The output buffer the canonical form is appended to
+ */
+void canonicalize(const std::shared_ptr<Syntax> &root, std::string &out);
+
+/**
+ * @brief      Hash the canonical form of the tree with 128-bit FNV-1a
+ *
+ * @param      root  The root of the tree
+ * @param      salt  Data hashed before the tree, e.g. the analyzer command
+ *                   whose verdicts are keyed by the hash
+ *
+ * @return     The hash
+ */
+TreeHash hashTree(const std::shared_ptr<Syntax> &root,
+                  const std::string             &salt = std::string());
+}
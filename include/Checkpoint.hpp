@@ -0,0 +1,59 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace FuzzyTest
+{
+/**
+ * @brief      State of a generation run, enough to resume it after the
+ *             process was killed.
+ *
+ * The tree of the current program is not stored. It is generated again from
+ * the random state the program started with, then the children orderings
+ * and the position of the variant stream are applied to it.
+ */
+struct Checkpoint
+{
+    /** Options and initial random state of the run */
+    std::string fingerprint;
+    /** Index of the program in progress */
+    uint64_t program = 0;
+    /** Random state at the start of the program */
+    std::string startRandom;
+    /** Number of variants walked so far */
+    uint64_t variant = 0;
+    /** Size of the corpus file, in corpus mode */
+    uint64_t outputSize = 0;
+    /** Size of the swap list, in the Gray code order */
+    uint64_t swapsSize = 0;
+    /** Random state after the last walked variant, empty if none */
+    std::string random;
+    /** Children orderings of the last walked variant, as in the corpus */
+    std::string ordering;
+    /** Position of the variant stream */
+    std::string stream;
+
+    /**
+     * @brief      Write the checkpoint atomically, the previous one is
+     *             replaced only once the new one is complete
+     *
+     * @param      file  The file
+     *
+     * @return     @c true on success
+     */
+    bool save(const std::string &file) const;
+
+    /**
+     * @brief      Load the checkpoint
+     *
+     * @param      file  The file
+     *
+     * @return     @c false if there is no valid checkpoint
+     */
+    bool load(const std::string &file);
+};
+}
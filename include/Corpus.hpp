@@ -0,0 +1,140 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Syntax.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Delta-encoded storage of a program and its permutations.
+ *
+ * The corpus keeps the primary tree in a binary form once, and every variant
+ * as the list of nodes whose children differ from the primary tree together
+ * with the new order of those children.
+ */
+class Corpus
+{
+public:
+    /**
+     * @brief      Construct the corpus for the primary tree
+     *
+     * @param      root  The primary tree, must not be permuted yet
+     */
+    explicit Corpus(std::shared_ptr<Syntax> root);
+    virtual ~Corpus() = default;
+    Corpus(const Corpus &rhs) = default;
+    Corpus &operator=(const Corpus &rhs) = default;
+
+    /**
+     * @brief      Get the root of the tree
+     *
+     * @return     The root
+     */
+    std::shared_ptr<Syntax> getRoot() const
+    {
+        return _root;
+    }
+
+    /**
+     * @brief      Encode the corpus header and the primary tree
+     *
+     * @param      out   The output buffer
+     */
+    void encodePrimary(std::string &out) const;
+
+    /**
+     * @brief      Encode the current state of the tree as a variant
+     *
+     * @param      index  The index of the variant
+     * @param      out    The output buffer
+     */
+    void encodeVariant(size_t index, std::string &out) const;
+
+    /**
+     * @brief      Decode one variant and reorder the tree accordingly
+     *
+     * @param      pos    The current position, advanced past the variant
+     * @param      end    The end of the buffer
+     * @param      index  The index of the decoded variant
+     *
+     * @return     @c true on success, @c false if the data is malformed or
+     *             not a permutation, the tree is left in the primary state
+     *             then
+     */
+    bool decodeVariant(const char *&pos, const char *end, size_t &index);
+
+    /**
+     * @brief      Bring the tree back to the primary state
+     */
+    void restorePrimary();
+
+    /**
+     * @brief      Get the number of nodes whose children may be permuted
+     *
+     * @return     The number of nodes
+     */
+    size_t nodeCount() const
+    {
+        return _nodes.size();
+    }
+
+    /**
+     * @brief      Get the current order of the permuted children of the node
+     *
+     * @param      node   The index of the node
+     * @param      order  The primary positions of the children in their
+     *                    current order
+     *
+     * @return     @c false if the children are in their primary order
+     */
+    bool getOrder(size_t node, std::vector<uint32_t> &order) const;
+
+    /**
+     * @brief      Decode the corpus header and the primary tree
+     *
+     * @param      pos   The current position, advanced past the tree
+     * @param      end   The end of the buffer
+     *
+     * @return     The primary tree or @c nullptr if the data is malformed
+     */
+    static std::shared_ptr<Syntax> decodePrimary(const char *&pos,
+                                                 const char *end);
+
+    /**
+     * @brief      Expand the corpus file into C files
+     *
+     * @param      file     The corpus file
+     * @param      path     The path to the folder where to put results
+     * @param      variant  The only variant to expand, or @c -1 for all
+     *
+     * @return     @c true on success, @c false otherwise
+     */
+    static bool expand(const std::string &file,
+                       const std::string &path,
+                       long long          variant);
+
+private:
+    struct Node
+    {
+        std::shared_ptr<Syntax>                      node;
+        size_t                                       start;
+        std::vector<std::shared_ptr<Syntax>>         primary;
+        /* Primary position of every child, built once */
+        std::unordered_map<const Syntax *, uint32_t> positions;
+    };
+
+    void collect(const std::shared_ptr<Syntax> &node);
+
+    std::shared_ptr<Syntax> _root;
+    std::vector<Node>       _nodes;
+    /* Positions already placed by decodeVariant(), reused for every node */
+    std::vector<char>       _used;
+};
+}
@@ -0,0 +1,170 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Syntax.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Classes of expressions the library provides
+ */
+enum class ExpressionClass
+{
+    /** Evaluates to the value substituted into the template */
+    Value,
+    /** Always true whatever the value is */
+    True,
+    /** Always false whatever the value is */
+    False,
+    Count,
+};
+
+/**
+ * @brief      Pool of expression templates with a hole for a constant.
+ *
+ * Every literal of a template is either a constant or a hole standing for
+ * a * V + c modulo 2^32, where V is substituted when the template is
+ * instantiated. Templates are built once with the same shapes the generator
+ * builds expressions with, or loaded from a text file, and every template is
+ * validated symbolically: a value template must reduce to V modulo 2^32 and
+ * a predicate must hold or fail for any V. Instantiating a template takes
+ * time proportional to its size and takes no random decisions.
+ *
+ * The text file has one template per line: the class (@c value, @c true or
+ * @c false) followed by cells in pre-order. A cell is an operator
+ * (@c + @c - @c & @c ^), a constant @c k:TEXT or a hole @c h:A:C. A
+ * predicate starts with its comparison, and its right operand may be
+ * @c @ to reuse the left one.
+ */
+class ExpressionLibrary
+{
+public:
+    /**
+     * @brief      Build the pool
+     *
+     * @param      count           The number of templates of every class
+     * @param      literalPercent  Percentage of plain literals, see Options
+     * @param      seed            The seed of the templates
+     */
+    void build(size_t count, int literalPercent, uint64_t seed = 1);
+
+    /**
+     * @brief      Load the pool from the text file
+     *
+     * @param      file  The file name
+     *
+     * @return     @c false if the file can't be read or a template is
+     *             malformed or invalid
+     */
+    bool load(const std::string &file);
+
+    /**
+     * @brief      Save the pool into the text file
+     *
+     * @param      file  The file name
+     *
+     * @return     @c true on success
+     */
+    bool save(const std::string &file) const;
+
+    /**
+     * @brief      Get the number of templates of the class
+     *
+     * @param      kind  The class
+     *
+     * @return     The number of templates
+     */
+    size_t size(ExpressionClass kind) const
+    {
+        return _templates[static_cast<size_t>(kind)].size();
+    }
+
+    /**
+     * @brief      Instantiate the template
+     *
+     * @param      kind   The class
+     * @param      index  The index of the template in the class
+     * @param      value  The value substituted into holes
+     *
+     * @return     The expression
+     */
+    std::shared_ptr<Syntax> instantiate(ExpressionClass kind,
+                                        size_t          index,
+                                        uint32_t        value) const;
+
+private:
+    /** One node of a template */
+    struct Cell
+    {
+        enum Kind
+        {
+            Operator,
+            Constant,
+            Hole,
+            Same,
+        } kind;
+        /** Operator or constant spelling */
+        std::string text;
+        /** Coefficient of the hole */
+        uint32_t a;
+        /** Offset of the hole or value of the constant */
+        uint32_t c;
+    };
+
+    using Template = std::vector<Cell>;
+
+    /** Value of an expression, a * V + c modulo 2^32 */
+    struct Affine
+    {
+        uint32_t a;
+        uint32_t c;
+    };
+
+    struct Builder;
+
+    /**
+     * @brief      Check that the template belongs to the class
+     *
+     * @param      cells  The template
+     * @param      kind   The class
+     *
+     * @return     @c true if valid
+     */
+    static bool validate(const Template &cells, ExpressionClass kind);
+
+    /**
+     * @brief      Reduce the value template starting at the position
+     *
+     * @param      cells  The template
+     * @param      pos    The position, advanced past the subtree
+     * @param      value  The value of the subtree
+     *
+     * @return     @c false if the subtree is malformed or its value is not
+     *             affine in V
+     */
+    static bool evaluate(const Template &cells, size_t &pos, Affine &value);
+
+    /**
+     * @brief      Instantiate the value subtree starting at the position
+     *
+     * @param      cells  The template
+     * @param      pos    The position, advanced past the subtree
+     * @param      value  The value substituted into holes
+     *
+     * @return     The expression
+     */
+    static std::shared_ptr<Syntax> instantiate(const Template &cells,
+                                               size_t         &pos,
+                                               uint32_t        value);
+
+    std::vector<Template> _templates[static_cast<size_t>(
+        ExpressionClass::Count)];
+};
+}
@@ -5,10 +5,19 @@
 #pragma once
 #include <functional>
 #include <unordered_map>
+#include "Options.hpp"
+#include "Random.hpp"
+#include "NameAllocator.hpp"
 #include "Syntax.hpp"
+#include "VariantStream.hpp"
 
 namespace FuzzyTest
 {
+struct Checkpoint;
+class AstFile;
+class ExpressionLibrary;
+class PerfCounters;
+
 class Generator
 {
 public:
@@ -18,13 +27,75 @@ public:
     Generator& operator=(const Generator &rhs) = default;
 
     /**
-     * @brief      Generate a random string of given @p length
+     * @brief      Set the run-time options
+     *
+     * @param      options  The options
+     */
+    void setOptions(const Options &options)
+    {
+        _options = options;
+    }
+
+    /**
+     * @brief      Get the run-time options
+     *
+     * @return     The options
+     */
+    const Options &options() const
+    {
+        return _options;
+    }
+
+    /**
+     * @brief      Set the source of random decisions
+     *
+     * @param      source  The random source
+     */
+    void setRandomSource(std::shared_ptr<RandomSource> source)
+    {
+        _random = source;
+    }
+
+    /**
+     * @brief      Prepare the expression library if the options request it:
+     *             load the expression file if it exists, otherwise build the
+     *             templates and save them into the file
+     *
+     * @return     @c false if the expression file is invalid
+     */
+    bool prepareExpressions();
+
+    /**
+     * @brief      Prepare the expression library of the options once, so
+     *             it can be shared by generators of many programs
+     *
+     * @param      options  The options
+     * @param      library  Receives the library, nullptr if the options
+     *                      don't request it
+     *
+     * @return     @c false if the expression file is invalid
+     */
+    static bool loadExpressions(
+        const Options                            &options,
+        std::shared_ptr<const ExpressionLibrary> &library);
+
+    /**
+     * @brief      Use a prepared expression library instead of preparing
+     *             another one
      *
-     * @param      length  The length of the string
+     * @param      library  The library prepared for the same options
+     */
+    void setExpressions(std::shared_ptr<const ExpressionLibrary> library)
+    {
+        _expressions = library;
+    }
+
+    /**
+     * @brief      Generate an identifier unique within the program
      *
-     * @return     Random string
+     * @return     The identifier
      */
-    std::string             generateString(size_t length);
+    std::string             generateName();
 
     /**
      * @brief      Generate a random value of given @p type
@@ -33,7 +104,7 @@ public:
      *
      * @return     Random value
      */
-    std::string             generateValue(std::string type);
+    std::string             generateValue(const std::string &type);
 
     /**
      * @brief      Pick one random variable
@@ -43,7 +114,7 @@ public:
      * @return     Syntax node pointing to one of variables
      */
     std::shared_ptr<Syntax> pickRandomVar(
-        std::vector<std::vector<std::shared_ptr<Syntax>>> vars);
+        const std::vector<std::vector<std::shared_ptr<Syntax>>> &vars);
 
     /**
      * @brief      Create a random obfuscated block
@@ -55,6 +126,16 @@ public:
     std::shared_ptr<Syntax> createRandomObfuscatedBlock(
         std::vector<std::vector<std::shared_ptr<Syntax>>> &falseVars);
 
+    /**
+     * @brief      Get the index of the first child taking part in
+     *             permutations of a node of the given @p kind
+     *
+     * @param      kind  The syntax node kind
+     *
+     * @return     The index or @c -1 if children are never permuted
+     */
+    static int getPermutationStart(SyntaxKind kind);
+
     /**
      * @brief      Permute children of the selected node
      *
@@ -63,11 +144,12 @@ public:
      * @param      callback  The callback which is triggered in order to save
      *                       the syntax tree
      *
-     * @return     { description_of_the_return_value }
+     * @return     @c -1 indicates that process was stopped, otherwise it is
+     *             a number of produced variants
      */
-    int permute(std::shared_ptr<Syntax> root,
-                int                     shift,
-                std::function<bool()>   callback);
+    int permute(const std::shared_ptr<Syntax> &root,
+                int                            shift,
+                const std::function<bool()>   &callback);
 
     /**
      * @brief      Permute syntax node children
@@ -79,14 +161,14 @@ public:
      * @param      callback  The callback which is triggered in order to save
      *                       the syntax tree
      *
-     * @return     @c -1 indicates that process should be stopped,
-     *             otherwise it is a number of processed nodes
+     * @return     @c -1 indicates that process was stopped, otherwise it is
+     *             a number of produced variants
      */
     int permute(std::vector<std::shared_ptr<Syntax>> &children,
                 int                                   start,
                 int                                   end,
                 int                                   shift,
-                std::function<bool()>                 callback);
+                const std::function<bool()>          &callback);
 
     /**
      * @brief      Obfuscate the goal with several false expressions
@@ -117,13 +199,184 @@ public:
      *
      * @return     The expression evaluating to @p value.
      */
-    std::shared_ptr<Syntax> getExpressionEvaluatingToValue(std::string value);
+    std::shared_ptr<Syntax> getExpressionEvaluatingToValue(
+        const std::string &value);
+
+    /**
+     * @brief      Add the obfuscated assignment of the goal to a new variable
+     *             followed by the check of the variable
+     *
+     * @param      block  The block to add statements to
+     * @param      goal   The goal value
+     *
+     * @return     The variable holding the goal
+     */
+    std::shared_ptr<Syntax> addObfuscatedGoal(std::shared_ptr<Syntax> block,
+                                              std::shared_ptr<Syntax> goal);
+
+    /**
+     * @brief      Add more independent obfuscated goals with their asserts
+     *
+     * @param      block  The block to add statements to
+     * @param      count  The number of goals
+     */
+    void addGoals(std::shared_ptr<Syntax> block, size_t count);
+
+    /**
+     * @brief      Generate a random program
+     *
+     * @return     The root of the program syntax tree, @c nullptr if the
+     *             expression library can't be prepared
+     */
+    std::shared_ptr<Syntax> generateProgram();
+
+    /**
+     * @brief      Generate a random program consisting of many functions,
+     *             each with its own obfuscated goal, calling each other
+     *
+     * Generation stops as soon as any of the non-zero targets is reached.
+     *
+     * @param      targetBytes  The target size in bytes of rendered code
+     * @param      targetNodes  The target size in syntax nodes
+     *
+     * @return     The root of the program syntax tree, @c nullptr if the
+     *             expression library can't be prepared
+     */
+    std::shared_ptr<Syntax> generateLargeProgram(size_t targetBytes,
+                                                 size_t targetNodes);
 
     /**
-     * @brief      Generate a test script
+     * @brief      Generate test programs and write them with their variants
+     *
+     * With a checkpoint file set in the options, the run periodically saves
+     * its state and resumes from the saved one when started again.
      *
      * @param      path  The path to the folder where to put results
+     *
+     * @return     @c false if the checkpoint can't be resumed
+     */
+    bool generateTestScript(const std::string &path);
+
+    /**
+     * @brief      Bring the tree to every variant the command line would write
+     *             for it: in the variant order of the options, up to the
+     *             limit of variants, only those chosen by the minimizer and
+     *             only those of the shard
+     *
+     * @param      root      The root of the program syntax tree, left in the
+     *                       primary state afterwards
+     * @param      callback  The callback taking the index of the variant
+     */
+    void forEachVariant(const std::shared_ptr<Syntax>     &root,
+                        const std::function<void(size_t)> &callback);
+
+private:
+    /**
+     * @brief      Spread the goals of the program across functions called
+     *             from main
+     *
+     * @param      root       The root with the prelude
+     * @param      goals      The number of goals
+     * @param      functions  The number of functions
+     *
+     * @return     The root of the program syntax tree
+     */
+    std::shared_ptr<Syntax> generateGoalFunctions(std::shared_ptr<Syntax> root,
+                                                  size_t goals,
+                                                  size_t functions);
+
+    /**
+     * @brief      Save the checkpoint of the run, the run goes on without it
+     *             if it can't be saved, which is reported once
+     *
+     * @param      checkpoint  The checkpoint
+     */
+    void saveCheckpoint(const Checkpoint &checkpoint);
+
+    /**
+     * @brief      Generate one program and write it with its variants, as C
+     *             files or as a delta-encoded corpus
+     *
+     * @param      path        The path to the folder where to put results
+     * @param      checkpoint  The checkpoint of the run, @c nullptr if the
+     *                         run is not checkpointed
+     * @param      resume      Whether the program is resumed from the
+     *                         checkpoint
+     *
+     * @return     @c false if the checkpoint can't be resumed
+     */
+    bool emitProgram(const std::string &path,
+                     Checkpoint        *checkpoint,
+                     bool               resume);
+
+    /**
+     * @brief      Get a random value
+     *
+     * @return     The value in range [0, RAND_MAX]
+     */
+    uint32_t random()
+    {
+        return _random->next();
+    }
+
+    /**
+     * @brief      Get a random value below the @p bound
+     *
+     * @param      bound  The bound
+     *
+     * @return     The value in range [0, bound)
+     */
+    uint32_t random(size_t bound)
+    {
+        return _random->next(bound);
+    }
+
+    /**
+     * @brief      Pick the next obfuscation step
+     *
+     * @param      shaped  Whether shape options apply to the obfuscation
+     * @param      steps   The number of steps taken so far
+     *
+     * @return     The obfuscation branch, @c 0 stops the obfuscation
+     */
+    int nextObfuscationStep(bool shaped, int &steps);
+
+    /**
+     * @brief      Pick a random obfuscation branch according to the weights
+     *
+     * @return     The obfuscation branch (1-6)
+     */
+    int pickWeightedBranch();
+
+    /**
+     * @brief      Decide whether one more branch of an if group or a switch
+     *             should be generated
+     *
+     * @param      shaped  Whether shape options apply to the obfuscation
+     * @param      limit   The requested number of branches, @c -1 if random
+     * @param      count   The number of branches generated so far
+     *
+     * @return     @c true if another branch should be generated
      */
-    void generateTestScript(std::string path);
+    bool nextBranch(bool shaped, int limit, int &count);
+
+    Options                       _options;
+    int                           _nesting = 0;
+    std::shared_ptr<RandomSource> _random =
+        std::make_shared<StdRandomSource>();
+
+    /* Identifiers of the program being generated */
+    NameAllocator                 _names;
+    /* Precomputed expressions, nullptr if built from random decisions */
+    std::shared_ptr<const ExpressionLibrary> _expressions;
+
+    /* Counters of pipeline stages, nullptr if not profiling */
+    PerfCounters                 *_perf = nullptr;
+    /* Tree loaded instead of generating one, nullptr if generating */
+    const AstFile                *_ast = nullptr;
+    /* Whether the run failed to save the checkpoint already */
+    bool                          _checkpointFailed = false;
+
+    friend class VariantStream;
 };
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Corpus.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Selection of variants covering every ordering of children.
+ *
+ * An ordering is a run of @c strength consecutive children of a permuted
+ * node, identified by the node and the primary positions of the children
+ * (the whole list if the node has fewer children). With the default strength
+ * of 2 these are the adjacent pairs. Runs kept in their primary order are
+ * covered by the primary program, which is always emitted, so a variant only
+ * contributes the orderings of nodes it changes. The smallest subset of
+ * variants covering the orderings of all of them is approximated by the lazy
+ * greedy set cover: covered orderings are kept in a bitset, and the gain of
+ * a variant is recounted only when it reaches the top of the queue, as gains
+ * never grow.
+ */
+class Minimizer
+{
+public:
+    /**
+     * @brief      Construct the minimizer
+     *
+     * @param      strength  The number of consecutive children in an ordering
+     */
+    explicit Minimizer(size_t strength = 2);
+
+    /**
+     * @brief      Record the orderings of the current state of the tree as the
+     *             next variant
+     *
+     * @param      corpus  The corpus of the tree
+     */
+    void add(const Corpus &corpus);
+
+    /**
+     * @brief      Choose the variants to keep
+     *
+     * @return     Indices of the chosen variants in the order they were added,
+     *             sorted
+     */
+    std::vector<size_t> select() const;
+
+    /**
+     * @brief      Get the number of variants added
+     *
+     * @return     The number of variants
+     */
+    size_t size() const
+    {
+        return _offsets.size() - 1;
+    }
+
+    /**
+     * @brief      Get the number of distinct orderings not in the primary
+     *             program
+     *
+     * @return     The number of orderings
+     */
+    size_t orderingCount() const
+    {
+        return _ids.size();
+    }
+
+private:
+    size_t                                    _strength;
+    /* Ordering keys and their dense indices */
+    std::unordered_map<std::string, uint32_t> _ids;
+    /* Sorted orderings of all variants, one after another */
+    std::vector<uint32_t>                     _orderings;
+    /* Start of the orderings of every variant, and the end of the last */
+    std::vector<size_t>                       _offsets;
+    /* Buffers reused for every variant */
+    std::vector<uint32_t>                     _order;
+    std::string                               _key;
+};
+}
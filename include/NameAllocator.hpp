@@ -0,0 +1,74 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Allocator of identifiers unique within a program.
+ *
+ * Names of a given length form a dense space of 52 * 62^(length - 1)
+ * strings: a letter followed by letters and digits. A counter is walked
+ * through an affine permutation of the space, (multiplier * counter +
+ * offset) mod size with the multiplier coprime to the size, and the result
+ * is written in the mixed-radix charset. Every name is therefore distinct
+ * and costs O(1), while looking as random as before. Once the space is
+ * used up, names grow one character longer. C keywords and names the
+ * programs rely on are skipped.
+ */
+class NameAllocator
+{
+public:
+    /**
+     * @brief      Construct the allocator
+     *
+     * @param      length  The length of the first names
+     */
+    explicit NameAllocator(size_t length = 3);
+
+    /**
+     * @brief      Start a new program, all names become available again
+     *
+     * @param      seed  The seed choosing the permutation
+     */
+    void reset(uint64_t seed);
+
+    /**
+     * @brief      Allocate the next name
+     *
+     * @return     The name, distinct from all allocated since reset()
+     */
+    std::string next();
+
+    /**
+     * @brief      Get the length of names allocated now
+     *
+     * @return     The length
+     */
+    size_t length() const
+    {
+        return _length;
+    }
+
+private:
+    /**
+     * @brief      Start allocating names of the length
+     *
+     * @param      length  The length
+     */
+    void startLength(size_t length);
+
+    size_t   _initialLength;
+    size_t   _length;
+    uint64_t _seed = 0;
+    uint64_t _space = 0;
+    uint64_t _multiplier = 1;
+    uint64_t _offset = 0;
+    uint64_t _counter = 0;
+};
+}
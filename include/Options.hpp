@@ -0,0 +1,143 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Order in which variants of a program are walked
+ */
+enum class VariantOrder
+{
+    /** Nested lexicographic permutations of children */
+    Lexicographic,
+    /** Every variant differs from the previous one by one adjacent swap */
+    GrayCode,
+};
+
+/**
+ * @brief      Run-time options controlling what the generator emits
+ */
+struct Options
+{
+    /** Maximum number of variants to enumerate, @c 0 means unlimited */
+    size_t variantLimit = 100;
+    /** Index of the shard processed by this instance */
+    size_t shardIndex = 0;
+    /** Total number of shards the variant index space is split into */
+    size_t shardCount = 1;
+    /** Store variants as a delta-encoded corpus instead of C files */
+    bool corpus = false;
+    /** Generate a multi-function program of at least this many bytes */
+    size_t targetBytes = 0;
+    /** Generate a multi-function program of at least this many nodes */
+    size_t targetNodes = 0;
+    /** Number of obfuscation steps applied to each goal, @c -1 if random */
+    int obfuscationDepth = -1;
+    /** The only obfuscation branch to take (1-6), @c -1 if random */
+    int obfuscationBranch = -1;
+    /** Number of secondary cases in goal switches, @c -1 if random */
+    int switchCases = -1;
+    /** Number of else branches in goal if groups, @c -1 if random */
+    int ifGroupLength = -1;
+    /** Relative weights of obfuscation branches 1-6, all zero if uniform */
+    std::array<unsigned, 6> branchWeights = {};
+    /**
+     * Percentage of value expressions which are plain literals, @c -1 for
+     * the default mix. Values below 50 may produce unbounded expressions.
+     */
+    int literalPercent = -1;
+    /**
+     * Number of independent goals checked by every program (by every
+     * function of large programs), @c 0 for one goal and no list of asserts
+     */
+    size_t goals = 0;
+    /** Number of functions the goals of a program are spread across */
+    size_t goalFunctions = 1;
+    /** Report heap allocations per program and per variant */
+    bool countAllocations = false;
+    /** Report hardware performance counters of pipeline stages */
+    bool perfCounters = false;
+    /** Threads rendering large programs, @c 0 for one per CPU */
+    unsigned renderThreads = 0;
+    /** Number of programs generated one after another */
+    size_t programs = 1;
+    /** File keeping the state of the run, empty if not checkpointed */
+    std::string checkpointFile;
+    /** Number of variants between two checkpoints */
+    size_t checkpointInterval = 10000;
+    /** Binary tree file permuted instead of a generated tree, if not empty */
+    std::string astFile;
+    /** Save the binary tree of every program next to its primary */
+    bool saveAst = false;
+    /** Order in which variants are walked */
+    VariantOrder variantOrder = VariantOrder::Lexicographic;
+    /**
+     * Number of precomputed expression templates of every class, @c 0 to
+     * build every expression from random decisions
+     */
+    size_t expressions = 0;
+    /** File the expression templates are loaded from or saved to */
+    std::string expressionFile;
+    /**
+     * Number of consecutive children in the orderings minimized variants
+     * cover, @c 0 to keep every variant
+     */
+    size_t minimizeStrength = 0;
+
+    /**
+     * @brief      Check whether the variant belongs to the current shard
+     *
+     * Every shard still walks all variants before and between its own, as
+     * a variant can only be reached from the previous one.
+     *
+     * @param      index  The global index of the variant
+     *
+     * @return     @c true if the variant should be emitted by this instance
+     */
+    bool ownsVariant(size_t index) const
+    {
+        return index % shardCount == shardIndex;
+    }
+
+    /**
+     * @brief      Check whether obfuscation branches have custom weights
+     *
+     * @return     @c true if any weight is set
+     */
+    bool hasBranchWeights() const
+    {
+        for (auto weight : branchWeights)
+        {
+            if (weight != 0)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief      Check whether a large multi-function program is requested
+     *
+     * @return     @c true if any target size is set
+     */
+    bool isLargeProgram() const
+    {
+        return targetBytes != 0 || targetNodes != 0;
+    }
+
+    /**
+     * @brief      Check whether expressions come from precomputed templates
+     *
+     * @return     @c true if the expression library is requested
+     */
+    bool usesExpressionLibrary() const
+    {
+        return expressions != 0 || !expressionFile.empty();
+    }
+};
+}
@@ -0,0 +1,80 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Output for Syntax::render() writing into a caller-owned buffer.
+ *
+ * Characters which do not fit into the buffer are dropped, but still
+ * counted, so size() always reports the full size of the rendering.
+ */
+class BufferOutput
+{
+public:
+    /**
+     * @brief      Construct the output
+     *
+     * @param      buffer    The buffer, may be @c nullptr if @p capacity is 0
+     * @param      capacity  The capacity of the buffer
+     */
+    BufferOutput(char *buffer, size_t capacity) :
+      _buffer(buffer), _capacity(capacity)
+    {
+    }
+
+    void append(const char *str, size_t length)
+    {
+        if (length == 0)
+            return;
+        if (_size < _capacity)
+        {
+            std::memcpy(_buffer + _size, str,
+                        length < _capacity - _size ? length
+                                                   : _capacity - _size);
+        }
+        _size += length;
+        _last = str[length - 1];
+    }
+
+    void append(const char *str)
+    {
+        append(str, std::strlen(str));
+    }
+
+    void append(const std::string &str)
+    {
+        append(str.data(), str.size());
+    }
+
+    void push_back(char ch)
+    {
+        if (_size < _capacity)
+            _buffer[_size] = ch;
+        _size++;
+        _last = ch;
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    char back() const
+    {
+        return _last;
+    }
+
+private:
+    char  *_buffer;
+    size_t _capacity;
+    size_t _size = 0;
+    char   _last = '\0';
+};
+}
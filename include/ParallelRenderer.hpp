@@ -0,0 +1,162 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Syntax.hpp"
+
+namespace FuzzyTest
+{
+class PerfCounters;
+
+/**
+ * @brief      Renders large trees with several threads into one buffer.
+ *
+ * The root, blocks and functions are split into independent pieces: whole
+ * subtrees, braces and the separators Syntax::render() puts between
+ * statements. The pieces are measured in parallel, then laid out one after
+ * another, which decides the separators, and finally rendered in parallel
+ * into their regions of the buffer. The result is byte-identical to
+ * Syntax::render().
+ *
+ * Only children of the root, blocks and functions are split, and those are
+ * never permuted, so one renderer serves every variant of the program.
+ * Permutations keep the size of every piece as well, so the layout is
+ * measured once and reused, unless rendering finds it changed. The worker
+ * threads are started once with the renderer and wait between renderings.
+ */
+class ParallelRenderer
+{
+public:
+    /**
+     * @brief      Construct the renderer
+     *
+     * @param      root     The root of the tree
+     * @param      threads  The number of threads, @c 0 for one per CPU
+     * @param      perf     The counters the worker threads add their work
+     *                      to, @c nullptr if not profiling
+     */
+    explicit ParallelRenderer(const std::shared_ptr<Syntax> &root,
+                              unsigned                       threads = 0,
+                              PerfCounters                  *perf = nullptr);
+    virtual ~ParallelRenderer();
+    ParallelRenderer(const ParallelRenderer &rhs) = delete;
+    ParallelRenderer &operator=(const ParallelRenderer &rhs) = delete;
+
+    /**
+     * @brief      Render the tree into the string
+     *
+     * @param      out   The output, replaced with the rendering
+     */
+    void render(std::string &out);
+
+    /**
+     * @brief      Render the tree straight into the mapped file
+     *
+     * @param      file  The file
+     *
+     * @return     @c true on success
+     */
+    bool renderToFile(const std::string &file);
+
+private:
+    /** Independently rendered part of the output */
+    struct Piece
+    {
+        /** The subtree, @c nullptr for text and separators */
+        const Syntax *node;
+        /** The text, a separator if @c nullptr as well */
+        const char   *text;
+        /** Piece whose offset separators are computed against */
+        size_t        mark;
+        /** Rendered size */
+        size_t        size;
+        /** Last rendered character */
+        char          last;
+        /** Offset in the output */
+        size_t        offset;
+    };
+
+    /**
+     * @brief      Split the node into pieces
+     *
+     * @param      node   The node
+     * @param      depth  The nesting depth of the node
+     */
+    void split(Syntax *node, int depth);
+
+    /**
+     * @brief      Measure the subtrees and lay the pieces out, unless that
+     *             was done already
+     *
+     * @return     The size of the rendering
+     */
+    size_t layout();
+
+    /**
+     * @brief      Render the pieces into the buffer
+     *
+     * @param      buffer  The buffer, large enough for layout()
+     *
+     * @return     @c false if a piece no longer matches the layout, which
+     *             has to be measured again then
+     */
+    bool write(char *buffer);
+
+    /**
+     * @brief      Run the function for every subtree piece in parallel
+     *
+     * @param      function  The function
+     */
+    template <typename Function>
+    void forEachSubtree(const Function &function);
+
+    /**
+     * @brief      Call the function of the job for the subtree piece
+     *
+     * @param      function  The function
+     * @param      piece     The piece
+     */
+    template <typename Function>
+    static void callFunction(const void *function, Piece &piece);
+
+    /**
+     * @brief      Take subtree pieces of the current job until none is left
+     */
+    void work();
+
+    /**
+     * @brief      Wait for jobs and work on them until the renderer is gone
+     *
+     * @param      perf  The counters to add the work to, may be @c nullptr
+     */
+    void serve(PerfCounters *perf);
+
+    std::shared_ptr<Syntax> _root;
+    unsigned                _threads;
+    std::vector<Piece>      _pieces;
+    bool                    _measured = false;
+    size_t                  _size = 0;
+
+    /* Threads helping the calling one, they wait for the next job */
+    std::vector<std::thread> _workers;
+    std::mutex               _mutex;
+    std::condition_variable  _started;
+    std::condition_variable  _finished;
+    uint64_t                 _job = 0;
+    unsigned                 _busy = 0;
+    bool                     _stop = false;
+
+    /* The current job, set before it is started */
+    void                   (*_call)(const void *, Piece &) = nullptr;
+    const void              *_function = nullptr;
+    std::atomic<size_t>      _next{ 0 };
+};
+}
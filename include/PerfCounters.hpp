@@ -0,0 +1,214 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Stages of the generation pipeline
+ */
+enum class PerfStage
+{
+    Build,
+    Obfuscate,
+    Permute,
+    Render,
+    Write,
+    Count
+};
+
+/**
+ * @brief      Hardware performance counters of the generation pipeline.
+ *
+ * Cycles, instructions, cache misses and branch misses of the calling thread
+ * are counted with perf_event_open(), together with its CPU time and the
+ * wall time. Helper threads count themselves with PerfThread and their
+ * counts go to the stage the calling thread is in. Stages nest, and every
+ * sample is attributed to the innermost stage only, so e.g. the obfuscation
+ * is not counted in the tree building around it. Counters which can't be
+ * opened are reported as unavailable, the times are always available.
+ *
+ * The hardware counters of a thread form one group, so they are always
+ * counted over the same time. If the kernel has to multiplex the group with
+ * other events, the counts are scaled up by the share of time it was
+ * counted and the report marks them as estimates.
+ */
+class PerfCounters
+{
+public:
+    PerfCounters();
+    virtual ~PerfCounters();
+    PerfCounters(const PerfCounters &rhs) = delete;
+    PerfCounters &operator=(const PerfCounters &rhs) = delete;
+
+    /**
+     * @brief      Enter the stage
+     *
+     * @param      stage  The stage
+     */
+    void enter(PerfStage stage);
+
+    /**
+     * @brief      Leave the stage entered last
+     */
+    void leave();
+
+    /**
+     * @brief      Count one more variant for per-variant figures
+     */
+    void countVariant()
+    {
+        _variants++;
+    }
+
+    /**
+     * @brief      Print per-stage and per-variant figures
+     *
+     * @param      out   The output stream
+     */
+    void report(std::ostream &out) const;
+
+private:
+    enum
+    {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        TaskClock,
+        CounterCount
+    };
+
+    static const size_t stageCount = static_cast<size_t>(PerfStage::Count);
+
+    /** Counts and times of the hardware group at the last read */
+    struct Reading
+    {
+        uint64_t values[CounterCount] = {};
+        uint64_t enabled = 0;
+        uint64_t running = 0;
+    };
+
+    /**
+     * @brief      Open the counters of the calling thread, the hardware ones
+     *             as one group led by the cycles
+     *
+     * @param      fds     Receives the file descriptors, @c -1 if not open
+     * @param      wanted  The counters to open, those open in the array,
+     *                     @c nullptr for all of them
+     *
+     * @return     The error of opening the cycles, @c 0 on success
+     */
+    static int openCounters(int *fds, const int *wanted);
+
+    /**
+     * @brief      Read the counters and get the counts since the last read
+     *
+     * @param      fds     The file descriptors
+     * @param      last    The last read, updated
+     * @param      counts  Receives the counts, scaled up for the time the
+     *                     hardware group was not counted
+     *
+     * @return     @c true if the hardware group was multiplexed meanwhile
+     */
+    static bool readCounters(const int *fds, Reading &last, uint64_t *counts);
+
+    /**
+     * @brief      Read the counters and attribute the difference since the
+     *             previous sample to the innermost stage
+     */
+    void sample();
+
+    int         _fds[CounterCount];
+    Reading     _last;
+    uint64_t    _totals[stageCount][CounterCount] = {};
+    double      _wall[stageCount] = {};
+    uint64_t    _calls[stageCount] = {};
+    uint64_t    _variants = 0;
+    std::string _error;
+
+    /* Counts of helper threads not attributed to a stage yet */
+    std::atomic<uint64_t> _pending[CounterCount] = {};
+    /* Helper threads counting now and the most of them at once */
+    std::atomic<unsigned> _threads{ 0 };
+    std::atomic<unsigned> _maxThreads{ 0 };
+    /* Whether any thread had its hardware counters multiplexed */
+    std::atomic<bool>     _multiplexed{ false };
+
+    std::chrono::steady_clock::time_point _lastTime;
+    std::vector<PerfStage>                _stack;
+
+    friend class PerfThread;
+};
+
+/**
+ * @brief      Counters of a helper thread, e.g. of a rendering worker.
+ *
+ * The object belongs to the helper thread: it is created, sampled and
+ * destroyed there. Every sample adds the counts since the previous one to
+ * the stage the thread of PerfCounters is in, so the helper must be sampled
+ * before that thread leaves the stage.
+ */
+class PerfThread
+{
+public:
+    /**
+     * @brief      Open the counters of the calling thread
+     *
+     * @param      counters  The counters, @c nullptr if not profiling
+     */
+    explicit PerfThread(PerfCounters *counters);
+    virtual ~PerfThread();
+    PerfThread(const PerfThread &rhs) = delete;
+    PerfThread &operator=(const PerfThread &rhs) = delete;
+
+    /**
+     * @brief      Add the counts since the previous sample to the counters
+     */
+    void sample();
+
+private:
+    PerfCounters         *_counters;
+    int                   _fds[PerfCounters::CounterCount];
+    PerfCounters::Reading _last;
+};
+
+/**
+ * @brief      Counts the enclosing scope as the stage
+ */
+class PerfScope
+{
+public:
+    /**
+     * @brief      Enter the stage
+     *
+     * @param      counters  The counters, @c nullptr if not profiling
+     * @param      stage     The stage
+     */
+    PerfScope(PerfCounters *counters, PerfStage stage) : _counters(counters)
+    {
+        if (_counters != nullptr)
+            _counters->enter(stage);
+    }
+
+    ~PerfScope()
+    {
+        if (_counters != nullptr)
+            _counters->leave();
+    }
+
+    PerfScope(const PerfScope &rhs) = delete;
+    PerfScope &operator=(const PerfScope &rhs) = delete;
+
+private:
+    PerfCounters *_counters;
+};
+}
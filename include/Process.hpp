@@ -0,0 +1,41 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <string>
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Resources consumed by a finished process
+ */
+struct ProcessResult
+{
+    /** Exit status of the process, @c -1 if it did not exit normally */
+    int    status = -1;
+    /** Wall clock time in seconds */
+    double wallSeconds = 0;
+    /** Peak resident set size in kilobytes */
+    long   peakRssKb = 0;
+    /** Standard output and error of the process, if captured */
+    std::string output;
+};
+
+/**
+ * @brief      Run a shell command on the file and wait for it
+ *
+ * Every @c {} in the @p command is replaced with the @p file, the file is
+ * appended to the command if there are none.
+ *
+ * @param      command  The shell command
+ * @param      file     The file to run the command on
+ * @param      capture  Whether standard output and error of the command are
+ *                      captured instead of being inherited
+ *
+ * @return     Resources consumed by the command
+ */
+ProcessResult runCommand(const std::string &command,
+                         const std::string &file,
+                         bool               capture = false);
+}
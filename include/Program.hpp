@@ -0,0 +1,132 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <functional>
+#include <memory>
+#include "Corpus.hpp"
+#include "Generator.hpp"
+#include "VariantStream.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      In-memory interface to one generated program and its variants.
+ *
+ * Programs render straight into caller-owned buffers. All variants are
+ * permutations of the primary program, so they have exactly the size of
+ * the primary one. Variants come in the variant order of the options, up
+ * to the limit of variants, the same as the command line writes them.
+ * Minimizing and sharding choose variants only after all of them are
+ * known, so such options are rejected.
+ */
+class Program
+{
+public:
+    /**
+     * @brief      Generate the program, check isValid() afterwards
+     *
+     * @param      seed         The seed, the same as used by the command
+     *                          line
+     * @param      options      The generator options
+     * @param      expressions  The expression library prepared for the
+     *                          options, nullptr to prepare it here
+     */
+    explicit Program(
+        unsigned int                             seed,
+        const Options                           &options = Options(),
+        std::shared_ptr<const ExpressionLibrary> expressions = nullptr);
+    virtual ~Program() = default;
+    Program(const Program &rhs) = delete;
+    Program &operator=(const Program &rhs) = delete;
+
+    /**
+     * @brief      Check whether the program was generated
+     *
+     * @return     @c false if the options minimize or shard variants or
+     *             the expression library of the options can't be prepared,
+     *             no other method may be called then
+     */
+    bool isValid() const
+    {
+        return _root != nullptr;
+    }
+
+    /**
+     * @brief      Get the size of the rendered program
+     *
+     * @return     The size in bytes, without a terminating null
+     */
+    size_t size() const;
+
+    /**
+     * @brief      Render the primary program into the buffer
+     *
+     * @param      buffer    The buffer
+     * @param      capacity  The capacity of the buffer
+     *
+     * @return     The full size of the program, the output is truncated if
+     *             it is larger than @p capacity
+     */
+    size_t render(char *buffer, size_t capacity) const;
+
+    /**
+     * @brief      Render every variant into the buffer and report it
+     *
+     * The stream is rewound first and the tree is brought back to the
+     * primary state afterwards, so every call reports the same variants.
+     *
+     * @param      buffer    The buffer reused for every variant
+     * @param      capacity  The capacity of the buffer
+     * @param      callback  Receives the index and the full size of the
+     *                       variant, returns @c true to stop
+     *
+     * @return     The number of reported variants
+     */
+    size_t forEachVariant(
+        char                                     *buffer,
+        size_t                                    capacity,
+        const std::function<bool(size_t, size_t)> &callback);
+
+    /**
+     * @brief      Bring the program to its next variant and render it
+     *
+     * Variants are pulled one at a time, so the caller may pause between
+     * them or interleave several programs. The stream starts over from the
+     * primary program after rewind().
+     *
+     * @param      buffer    The buffer
+     * @param      capacity  The capacity of the buffer
+     * @param      size      Receives the full size of the variant
+     *
+     * @return     @c false if there are no more variants
+     */
+    bool nextVariant(char *buffer, size_t capacity, size_t &size);
+
+    /**
+     * @brief      Bring the tree back to the primary state and restart the
+     *             stream of variants, which then repeats the same variants
+     */
+    void rewind();
+
+    /**
+     * @brief      Get the root of the program syntax tree
+     *
+     * @return     The root
+     */
+    std::shared_ptr<Syntax> getRoot() const
+    {
+        return _root;
+    }
+
+private:
+    Generator                     _generator;
+    std::shared_ptr<RandomSource> _random;
+    std::shared_ptr<Syntax>       _root;
+    Corpus                        _corpus;
+    std::unique_ptr<VariantStream> _stream;
+    /* State of the random source right after the program was generated */
+    std::string                   _randomState;
+};
+}
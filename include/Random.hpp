@@ -0,0 +1,145 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Source of all random decisions taken by the generator
+ */
+class RandomSource
+{
+public:
+    RandomSource() = default;
+    virtual ~RandomSource() = default;
+    RandomSource(const RandomSource &rhs) = default;
+    RandomSource &operator=(const RandomSource &rhs) = default;
+
+    /**
+     * @brief      Get a random value
+     *
+     * @return     The value in range [0, RAND_MAX]
+     */
+    virtual uint32_t next() = 0;
+
+    /**
+     * @brief      Get a random value below the @p bound
+     *
+     * @param      bound  The bound, must not be zero
+     *
+     * @return     The value in range [0, bound)
+     */
+    virtual uint32_t next(uint32_t bound)
+    {
+        return next() % bound;
+    }
+
+    /**
+     * @brief      Save the state of the source, so that it can continue
+     *             later from the same point
+     *
+     * @param      out   The output
+     *
+     * @return     @c false if the source can't save its state
+     */
+    virtual bool saveState(std::string &out) const
+    {
+        (void)out;
+        return false;
+    }
+
+    /**
+     * @brief      Restore the state written by saveState()
+     *
+     * @param      pos   The current position, advanced past the state
+     * @param      end   The end of the data
+     *
+     * @return     @c false if the state is malformed or can't be restored
+     */
+    virtual bool restoreState(const char *&pos, const char *end)
+    {
+        (void)pos;
+        (void)end;
+        return false;
+    }
+};
+
+/**
+ * @brief      Random source backed by @c std::rand()
+ */
+class StdRandomSource : public RandomSource
+{
+public:
+    uint32_t next() override
+    {
+        return std::rand();
+    }
+};
+
+/**
+ * @brief      Seeded random source owning its state.
+ *
+ * It is the additive feedback generator used by glibc @c rand(), so a seed
+ * produces the same programs as @c std::srand() with the same seed does on
+ * glibc, while independent generators may run side by side.
+ */
+class SeededRandomSource : public RandomSource
+{
+public:
+    /**
+     * @brief      Construct the random source
+     *
+     * @param      seed  The seed
+     */
+    explicit SeededRandomSource(unsigned int seed);
+
+    uint32_t next() override;
+    bool     saveState(std::string &out) const override;
+    bool     restoreState(const char *&pos, const char *end) override;
+
+private:
+    static const int degree = 31;
+    static const int separation = 3;
+
+    int32_t _state[degree];
+    int     _front = separation;
+    int     _rear = 0;
+};
+
+/**
+ * @brief      Random source backed by a byte stream, e.g. a fuzzer input.
+ *
+ * Every decision consumes as few bytes as its bound requires, so mutations
+ * of the input map to local changes of the generated program. When the
+ * stream is exhausted, values come from a pseudo-random generator seeded
+ * with the stream, which keeps every generation loop finite.
+ */
+class ByteStreamRandomSource : public RandomSource
+{
+public:
+    /**
+     * @brief      Construct the random source
+     *
+     * @param      data  The byte stream, must outlive the source
+     * @param      size  The size of the byte stream
+     */
+    ByteStreamRandomSource(const uint8_t *data, size_t size);
+
+    uint32_t next() override;
+    uint32_t next(uint32_t bound) override;
+
+private:
+    uint32_t take(size_t bytes);
+
+    const uint8_t *_data;
+    size_t         _size;
+    size_t         _pos = 0;
+    uint64_t       _state;
+};
+}
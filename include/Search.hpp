@@ -0,0 +1,89 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Options.hpp"
+
+namespace FuzzyTest
+{
+class ExpressionLibrary;
+
+/**
+ * @brief      Parameters of the performance-adversarial search
+ */
+struct SearchOptions
+{
+    /** Analyzer command, see runCommand() */
+    std::string command;
+    /** Number of programs kept in the population */
+    unsigned    population = 16;
+    /** Number of generations to evolve */
+    unsigned    generations = 10;
+    /** Number of analyzer runs the median wall time is taken of */
+    unsigned    repeat = 3;
+};
+
+/**
+ * @brief      Genetic search for programs the analyzer is slow on.
+ *
+ * Every individual is a generator seed together with the generator
+ * decisions (obfuscation depth and branches, number of cases and branches,
+ * expression shape). Its fitness is the median wall time of several runs
+ * of the analyzer on the program. The slowest programs are kept in the
+ * @c population folder along with @c population.csv listing the arguments,
+ * base options included, that regenerate each of them.
+ */
+class Search
+{
+public:
+    /**
+     * @brief      Construct the search
+     *
+     * @param      options  The base options of the generator
+     * @param      seed     The seed of the search
+     */
+    Search(const Options &options, unsigned long long seed);
+    virtual ~Search() = default;
+    Search(const Search &rhs) = default;
+    Search &operator=(const Search &rhs) = default;
+
+    /**
+     * @brief      Run the search
+     *
+     * @param      search  The search parameters
+     * @param      path    The path to the folder where to put results
+     *
+     * @return     @c true on success, @c false otherwise
+     */
+    bool run(const SearchOptions &search, const std::string &path);
+
+private:
+    struct Individual
+    {
+        unsigned long long seed;
+        Options            options;
+        std::string        program;
+        double             wallSeconds;
+    };
+
+    Individual random();
+    Individual crossover(const Individual &a, const Individual &b);
+    void       mutate(Individual &individual);
+    bool       evaluate(Individual          &individual,
+                        const SearchOptions &search,
+                        const std::string   &file);
+    bool       save(const std::vector<Individual> &population,
+                    const std::string             &path);
+
+    Options         _options;
+    std::mt19937_64 _random;
+    /* Expression libraries by the literal percentage they are built with */
+    std::map<int, std::shared_ptr<const ExpressionLibrary>> _expressions;
+};
+}
@@ -0,0 +1,53 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Syntax.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Append a variable-length encoded unsigned integer
+ *
+ * @param      out    The output buffer
+ * @param      value  The value
+ */
+void putVarint(std::string &out, uint64_t value);
+
+/**
+ * @brief      Read a variable-length encoded unsigned integer
+ *
+ * @param      pos    The current position, advanced past the value
+ * @param      end    The end of the buffer
+ * @param      value  The decoded value
+ *
+ * @return     @c true on success, @c false if the buffer is truncated
+ */
+bool getVarint(const char *&pos, const char *end, uint64_t &value);
+
+/**
+ * @brief      Serialize the syntax tree into a compact binary form
+ *
+ * Nodes are written in pre-order, nodes shared between several parents
+ * are written once and referenced afterwards.
+ *
+ * @param      root  The root of the tree
+ * @param      out   The output buffer the encoded tree is appended to
+ */
+void serializeTree(const std::shared_ptr<Syntax> &root, std::string &out);
+
+/**
+ * @brief      Deserialize the syntax tree written by serializeTree()
+ *
+ * @param      pos   The current position, advanced past the tree
+ * @param      end   The end of the buffer
+ *
+ * @return     The root of the tree or @c nullptr if the data is malformed,
+ *             refers a node to its ancestor or nests too deep
+ */
+std::shared_ptr<Syntax> deserializeTree(const char *&pos, const char *end);
+}
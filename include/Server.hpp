@@ -0,0 +1,91 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Options.hpp"
+
+namespace FuzzyTest
+{
+class ExpressionLibrary;
+
+/**
+ * @brief      Parameters of the generator server
+ */
+struct ServerOptions
+{
+    /**
+     * Unix domain socket path, or @c PORT / @c localhost:PORT to listen on
+     * the loopback TCP interface
+     */
+    std::string address;
+    /** Loopback TCP port of the address, @c 0 for a Unix domain socket */
+    uint16_t    port = 0;
+    /** Number of rendered programs and variants prefetched per client */
+    unsigned    prefetch = 64;
+};
+
+/**
+ * @brief      Long-running server feeding programs to analyzers.
+ *
+ * Every client gets its own prefetch thread which keeps a queue of rendered
+ * programs and variants filled, so the next one is served straight from
+ * memory. Clients draw programs from one sequence of seeds, so no two
+ * clients get the same program.
+ *
+ * Requests and responses are length-prefixed, integers are little-endian:
+ *
+ *     request  'N'                      next item of the client queue
+ *     request  'G' u32 seed, u64 index  item @c index of the program
+ *     response u8 status ('O' or 'E'), u32 seed, u64 index, u32 length,
+ *              length bytes of the program
+ *
+ * Item @c 0 of a program is the primary program, item @c i is the variant
+ * written to @c (i-1).c by the command line tool with the same seed, in
+ * the same variant order and up to the same limit. Minimizing and sharding
+ * choose variants only after all of them are known, so they aren't served.
+ */
+class Server
+{
+public:
+    /**
+     * @brief      Construct the server
+     *
+     * @param      options  The options of the generator
+     * @param      seed     The first seed handed out to clients
+     */
+    Server(const Options &options, unsigned long long seed);
+    virtual ~Server() = default;
+    Server(const Server &rhs) = delete;
+    Server &operator=(const Server &rhs) = delete;
+
+    /**
+     * @brief      Listen on the address and serve clients
+     *
+     * @param      server  The server parameters
+     *
+     * @return     @c false if the address can't be listened on or clients
+     *             can't be accepted anymore, the server does not return
+     *             otherwise
+     */
+    bool run(const ServerOptions &server);
+
+private:
+    /**
+     * @brief      Serve one client until it disconnects
+     *
+     * @param      fd        The client socket
+     * @param      prefetch  The number of prefetched items
+     */
+    void serveClient(int fd, unsigned prefetch);
+
+    Options                      _options;
+    std::atomic<unsigned long long> _nextSeed;
+    /* Shared by the programs of all clients, nullptr if not requested */
+    std::shared_ptr<const ExpressionLibrary> _expressions;
+};
+}
@@ -7,6 +7,7 @@
 #include <cassert>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include "SyntaxKind.hpp"
 
@@ -34,7 +35,7 @@ public:
 
     Syntax(SyntaxKind newKind, std::string newValue) : Syntax(newKind)
     {
-        _value = newValue;
+        _value = std::move(newValue);
     }
 
     virtual ~Syntax() = default;
@@ -56,11 +57,21 @@ public:
      *
      * @return     The string value
      */
-    std::string getStringValue() const
+    const std::string &getStringValue() const
     {
         return _value;
     }
 
+    /**
+     * @brief      Set the string value encoded in a syntax node
+     *
+     * @param      value  The string value
+     */
+    void setStringValue(const std::string &value)
+    {
+        _value = value;
+    }
+
     /**
      * @brief      Get children directly allowing for manipulations
      *
@@ -98,6 +109,25 @@ public:
         return str;
     }
 
+    /**
+     * @brief      Ensure that end-of-line is present for the part of the
+     *             output written since @p mark
+     *
+     * @param      out   The output
+     * @param      mark  The size of the output before the part was written
+     */
+    template <typename Output>
+    static void ensureEOL(Output &out, size_t mark)
+    {
+        if (out.size() == mark)
+        {
+            out.push_back(';');
+            return;
+        }
+        if (out.back() != ';' && out.back() != '}')
+            out.push_back(';');
+    }
+
     /**
      * @brief      Get a string representation of the syntax node
      *
@@ -105,6 +135,27 @@ public:
      */
     virtual std::string toString() const
     {
+        std::string result;
+
+        render(result);
+        return result;
+    }
+
+    /**
+     * @brief      Append a string representation of the syntax node to
+     *             the output
+     *
+     * The output has to provide @c append(), @c push_back(), @c size() and
+     * @c back() in the same way as @c std::string does.
+     *
+     * @param      out   The output
+     */
+    template <typename Output>
+    void render(Output &out) const
+    {
+        size_t start = out.size();
+        size_t mark;
+
         switch (_kind)
         {
             case SyntaxKind::Type:
@@ -112,200 +163,247 @@ public:
             case SyntaxKind::Literal:
             case SyntaxKind::Exact:
             {
-                return _value;
+                out.append(_value);
+                break;
             }
             case SyntaxKind::Declaration:
             {
-                std::string result;
-
                 assert(_children.size() >= 2);
-                result =
-                    _children[0]->toString() + " " + _children[1]->toString();
+                _children[0]->render(out);
+                out.push_back(' ');
+                _children[1]->render(out);
                 if (_children.size() == 3)
-                    result += " = " + _children[2]->toString();
-                return result;
+                {
+                    out.append(" = ");
+                    _children[2]->render(out);
+                }
+                break;
             }
             case SyntaxKind::Assign:
             {
-                std::string result;
-
                 assert(_children.size() == 2);
-                result =
-                    _children[0]->toString() + " = " + _children[1]->toString();
-                return result;
+                _children[0]->render(out);
+                out.append(" = ");
+                _children[1]->render(out);
+                break;
             }
             case SyntaxKind::Function:
             {
-                std::string result;
-
                 assert(_children.size() <= 2);
-                result = _children[0]->toString();
+                _children[0]->render(out);
                 if (_children[1]->_kind != SyntaxKind::Block)
-                    result += "{";
-                result += ensureEOL(_children[1]->toString());
+                    out.push_back('{');
+                mark = out.size();
+                _children[1]->render(out);
+                ensureEOL(out, mark);
                 if (_children[1]->_kind != SyntaxKind::Block)
-                    result += "}";
-                result = ensureEOL(result);
-                return result;
+                    out.push_back('}');
+                ensureEOL(out, start);
+                break;
             }
             case SyntaxKind::FunctionProto:
             {
-                std::string result;
-
                 assert(_children.size() >= 2);
-                result = _children[0]->toString() + " " +
-                    _children[1]->toString() + "(";
+                _children[0]->render(out);
+                out.push_back(' ');
+                _children[1]->render(out);
+                out.push_back('(');
                 for (int i = 2; i < _children.size(); ++i)
                 {
                     if (i != 2)
-                        result += ", ";
-                    result += _children[i]->toString();
+                        out.append(", ");
+                    _children[i]->render(out);
                 }
-                result += ")";
-                return result;
+                out.push_back(')');
+                break;
             }
             case SyntaxKind::Root:
             case SyntaxKind::Block:
             {
-                std::string result;
-
                 if (_kind == SyntaxKind::Block)
-                    result += "{";
+                    out.push_back('{');
                 for (auto &ch : _children)
                 {
-                    result += ch->toString();
+                    ch->render(out);
 
                     if (ch->_kind != SyntaxKind::Function &&
                         ch->_kind != SyntaxKind::Exact)
-                        result = ensureEOL(result);
+                        ensureEOL(out, start);
                 }
                 if (_kind == SyntaxKind::Block)
-                    result += "}";
-                return result;
+                    out.push_back('}');
+                break;
             }
             case SyntaxKind::IfGroup:
             {
-                std::string result;
-
                 for (int i = 0; i < _children.size(); ++i)
                 {
                     if (i == 0)
                     {
-                        result += "if ";
+                        out.append("if ");
                     }
                     else
                     {
                         if (_children[i] != nullptr)
-                            result += "else if ";
+                            out.append("else if ");
                         else
-                            result += "else ";
+                            out.append("else ");
                     }
 
-                    result += _children[i]->toString();
+                    _children[i]->render(out);
                 }
-
-                return result;
+                break;
             }
             case SyntaxKind::If:
             {
-                std::string result;
-
                 assert(_children.size() == 2);
 
-                result += "(" +
-                    (_children[0] != nullptr ? _children[0]->toString() : "") +
-                    ")";
-                std::string body;
+                out.push_back('(');
+                if (_children[0] != nullptr)
+                    _children[0]->render(out);
+                out.push_back(')');
                 if (_children[1]->_kind != SyntaxKind::Block)
                 {
-                    body = "{" + ensureEOL(_children[1]->toString()) + "}";
+                    out.push_back('{');
+                    mark = out.size();
+                    _children[1]->render(out);
+                    ensureEOL(out, mark);
+                    out.push_back('}');
                 }
                 else
                 {
-                    body = ensureEOL(_children[1]->toString());
+                    mark = out.size();
+                    _children[1]->render(out);
+                    ensureEOL(out, mark);
                 }
-                result += body;
-                return result;
+                break;
             }
             case SyntaxKind::Return:
             {
                 assert(_children.size() == 1);
-                return std::string("return ") + _children[0]->toString();
+                out.append("return ");
+                _children[0]->render(out);
+                break;
             }
             case SyntaxKind::Binary:
             {
-                std::string result;
-
                 assert(_children.size() == 2);
 
-                result += std::string("(") + _children[0]->toString() + ") " +
-                    _value + " (" + _children[1]->toString() + ")";
-                return result;
+                out.push_back('(');
+                _children[0]->render(out);
+                out.append(") ");
+                out.append(_value);
+                out.append(" (");
+                _children[1]->render(out);
+                out.push_back(')');
+                break;
             }
             case SyntaxKind::For:
             {
-                std::string result;
-
                 assert(_children.size() == 4);
 
-                result += "for (" + _children[0]->toString() + "; " +
-                    _children[1]->toString() + "; " + _children[2]->toString() +
-                    ")" + ensureEOL(_children[3]->toString());
-                return result;
+                out.append("for (");
+                _children[0]->render(out);
+                out.append("; ");
+                _children[1]->render(out);
+                out.append("; ");
+                _children[2]->render(out);
+                out.push_back(')');
+                mark = out.size();
+                _children[3]->render(out);
+                ensureEOL(out, mark);
+                break;
             }
             case SyntaxKind::While:
             {
-                std::string result;
-
                 assert(_children.size() == 2);
 
-                result += "while (" + _children[0]->toString() + ")" +
-                    ensureEOL(_children[1]->toString());
-                return result;
+                out.append("while (");
+                _children[0]->render(out);
+                out.push_back(')');
+                mark = out.size();
+                _children[1]->render(out);
+                ensureEOL(out, mark);
+                break;
             }
             case SyntaxKind::Switch:
             {
-                std::string result;
-
                 assert(_children.size() >= 1);
 
-                result +=
-                    std::string("switch (") + _children[0]->toString() + ") {";
+                out.append("switch (");
+                _children[0]->render(out);
+                out.append(") {");
 
                 for (int i = 1; i < _children.size(); i++)
                 {
-                    result += _children[i]->toString();
+                    _children[i]->render(out);
                 }
-                result += std::string("}");
-                return result;
+                out.push_back('}');
+                break;
             }
             case SyntaxKind::Case:
             {
-                std::string result;
-
                 assert(_children.size() >= 1);
-                result += std::string("case ") + _children[0]->toString() + ":";
+                out.append("case ");
+                _children[0]->render(out);
+                out.push_back(':');
                 for (int i = 1; i < _children.size(); ++i)
                 {
-                    result += ensureEOL(_children[i]->toString());
+                    mark = out.size();
+                    _children[i]->render(out);
+                    ensureEOL(out, mark);
                 }
-                return result;
+                break;
             }
             case SyntaxKind::Break:
             {
-                return std::string("break");
+                out.append("break");
+                break;
             }
             case SyntaxKind::Assert:
             {
                 assert(_children.size() == 1);
-                return std::string("assert(") + _children[0]->toString() + ")";
+                out.append("assert(");
+                _children[0]->render(out);
+                out.push_back(')');
+                break;
             }
             case SyntaxKind::Nop:
             {
-                return std::string(";");
+                out.push_back(';');
+                break;
+            }
+            case SyntaxKind::Call:
+            {
+                out.append(_value);
+                out.push_back('(');
+                for (size_t i = 0; i < _children.size(); ++i)
+                {
+                    if (i != 0)
+                        out.append(", ");
+                    _children[i]->render(out);
+                }
+                out.push_back(')');
+                break;
             }
         }
-        return "";
+    }
+
+    /**
+     * @brief      Count the syntax nodes in the tree
+     *
+     * @return     The number of nodes including this one
+     */
+    size_t countNodes() const
+    {
+        size_t count = 1;
+
+        for (auto &ch : _children)
+        {
+            if (ch != nullptr)
+                count += ch->countNodes();
+        }
+        return count;
     }
 
     static std::shared_ptr<Syntax> create(SyntaxKind kind)
@@ -321,7 +419,7 @@ public:
 
     static std::shared_ptr<Syntax> create(SyntaxKind kind, std::string value)
     {
-        return std::make_shared<Syntax>(kind, std::string(value));
+        return std::make_shared<Syntax>(kind, std::move(value));
     }
 
     template <typename Type>
@@ -369,7 +467,7 @@ public:
         auto result = std::make_shared<Syntax>(kind);
         auto vec = { args... };
 
-        result->_value = value;
+        result->_value = std::move(value);
         for (auto &obj : vec)
         {
             result->_children.push_back(obj);
@@ -29,5 +29,6 @@ namespace FuzzyTest
         Break,
         Assert,
         Nop,
+        Call,
     };
 }
@@ -0,0 +1,99 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Options.hpp"
+#include "Syntax.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Parameters of the compile validation
+ */
+struct ValidateOptions
+{
+    /** Compiler command, see runCommand() */
+    std::string command = "cc -fsyntax-only";
+    /** Number of programs and variants packed into one translation unit */
+    unsigned    chunk = 256;
+    /** Number of compilers run in parallel, @c 0 for one per CPU */
+    unsigned    jobs = 0;
+};
+
+/**
+ * @brief      Checks that generated programs and variants are valid C.
+ *
+ * Instead of compiling every file on its own, many programs and variants
+ * are packed into one translation unit sharing a single prelude, with the
+ * functions of each renamed after it. A @c #line directive before each of
+ * them names the file the command line tool would write it to, e.g.
+ * @c 3/17.c, so compiler diagnostics point at the program and variant
+ * directly. Translation units are compiled in parallel.
+ */
+class Validator
+{
+public:
+    /**
+     * @brief      Construct the validator
+     *
+     * @param      options  The options of the generator
+     * @param      seed     The seed, the same as used by the command line
+     */
+    Validator(const Options &options, unsigned long long seed);
+    virtual ~Validator() = default;
+    Validator(const Validator &rhs) = default;
+    Validator &operator=(const Validator &rhs) = default;
+
+    /**
+     * @brief      Generate and compile the programs with their variants
+     *
+     * Errors are reported for each failing program or variant.
+     * Translation units which failed to compile are kept in @p path.
+     *
+     * @param      validate  The validation parameters
+     * @param      path      The path to the folder for translation units
+     *
+     * @return     @c true if everything compiled
+     */
+    bool run(const ValidateOptions &validate, const std::string &path);
+
+private:
+    /** Node whose name is made unique in the translation unit */
+    struct Renamed
+    {
+        std::shared_ptr<Syntax> node;
+        std::string             name;
+    };
+
+    /**
+     * @brief      Collect function names and calls of the program
+     *
+     * @param      node     The node
+     * @param      renamed  The collected nodes
+     */
+    static void collectNames(const std::shared_ptr<Syntax> &node,
+                             std::vector<Renamed>          &renamed);
+
+    /**
+     * @brief      Append the program to the translation unit
+     *
+     * @param      root     The root of the program
+     * @param      renamed  The nodes to rename, see collectNames()
+     * @param      program  The program index
+     * @param      variant  The variant index, @c -1 for the primary program
+     * @param      out      The translation unit
+     */
+    static void append(const std::shared_ptr<Syntax> &root,
+                       const std::vector<Renamed>    &renamed,
+                       size_t                         program,
+                       long long                      variant,
+                       std::string                   &out);
+
+    Options            _options;
+    unsigned long long _seed;
+};
+}
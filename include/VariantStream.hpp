@@ -0,0 +1,301 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Options.hpp"
+#include "Syntax.hpp"
+
+namespace FuzzyTest
+{
+class Generator;
+
+/**
+ * @brief      Pull-based stream of program variants.
+ *
+ * The stream walks the same permutation sequence as the recursive
+ * permutation did, but keeps the recursion on an explicit stack, so it can
+ * be suspended after every variant and resumed later at no cost. Every call
+ * to next() brings the tree to the next variant in place.
+ *
+ * Random decisions are taken from the generator the stream was created with,
+ * so several streams may be interleaved as long as they use distinct
+ * generators.
+ *
+ * In the Gray code order every permuted node is a digit of a mixed-radix
+ * counter walked in the modular Gray code, so each step advances exactly
+ * one digit. A digit walks the permutations of its children in plain
+ * changes (Steinhaus-Johnson-Trotter) order, which is cyclic, so both the
+ * step and the wrap around are a single adjacent swap.
+ */
+class VariantStream
+{
+public:
+    /**
+     * @brief      Create the stream of variants of the tree
+     *
+     * @param      generator  The generator providing random decisions
+     * @param      root       The root of the tree, permuted in place
+     * @param      shift      The shift (indicates the recursion level)
+     */
+    VariantStream(Generator                     &generator,
+                  const std::shared_ptr<Syntax> &root,
+                  int                            shift = 0);
+
+    /**
+     * @brief      Create the stream of variants of the tree in the order
+     *
+     * @param      generator  The generator providing random decisions
+     * @param      root       The root of the tree, permuted in place
+     * @param      order      The order of variants
+     */
+    VariantStream(Generator                     &generator,
+                  const std::shared_ptr<Syntax> &root,
+                  VariantOrder                   order);
+
+    /**
+     * @brief      Create an empty stream, to be filled by restoreState()
+     *
+     * @param      generator  The generator providing random decisions
+     */
+    explicit VariantStream(Generator &generator);
+
+    /**
+     * @brief      Create the stream of permutations of the children range
+     *
+     * @param      generator  The generator providing random decisions
+     * @param      children   The syntax node children, permuted in place
+     * @param      start      The start index
+     * @param      end        The end index
+     * @param      shift      The shift (indicates the recursion level)
+     */
+    VariantStream(Generator                            &generator,
+                  std::vector<std::shared_ptr<Syntax>> &children,
+                  int                                   start,
+                  int                                   end,
+                  int                                   shift);
+
+    virtual ~VariantStream() = default;
+    VariantStream(const VariantStream &rhs) = default;
+    VariantStream &operator=(const VariantStream &rhs) = delete;
+
+    /**
+     * @brief      Bring the tree to the next variant
+     *
+     * @return     @c false if there are no more variants
+     */
+    bool next();
+
+    /**
+     * @brief      Get the number of variants produced so far
+     *
+     * @return     The number of variants
+     */
+    size_t count() const
+    {
+        return _count;
+    }
+
+    /**
+     * @brief      Check whether the stream was stopped by an empty
+     *             permutation range rather than exhausted
+     *
+     * @return     @c true if stopped
+     */
+    bool stopped() const
+    {
+        return _stopped;
+    }
+
+    /**
+     * @brief      Get the adjacent swap the last variant was produced by, in
+     *             the Gray code order only
+     *
+     * @param      node      The pre-order index of the node in the tree
+     *                       before the first variant
+     * @param      position  The index of the first of two swapped children
+     *
+     * @return     @c false if there is no variant yet or the order is not
+     *             the Gray code one
+     */
+    bool lastSwap(size_t &node, size_t &position) const;
+
+    /**
+     * @brief      Save the position of the stream
+     *
+     * Nodes are referred to by their indices in @p nodes, so the stream can
+     * be restored on a tree generated again from the same seed.
+     *
+     * @param      out    The output
+     * @param      nodes  The nodes of the tree, see collectNodes()
+     */
+    void saveState(std::string &out, const std::vector<Syntax *> &nodes) const;
+
+    /**
+     * @brief      Restore the position written by saveState()
+     *
+     * The children of the tree must already be in the order they had when
+     * the state was saved.
+     *
+     * @param      pos    The current position, advanced past the state
+     * @param      end    The end of the data
+     * @param      nodes  The nodes of the tree, see collectNodes()
+     *
+     * @return     @c false if the state is malformed
+     */
+    bool restoreState(const char                *&pos,
+                      const char                 *end,
+                      const std::vector<Syntax *> &nodes);
+
+    /**
+     * @brief      Collect nodes of the tree in pre-order, the order does
+     *             not depend on permutations of the tree as long as it is
+     *             collected before the first one
+     *
+     * @param      root   The root
+     * @param      nodes  The nodes
+     */
+    static void collectNodes(const std::shared_ptr<Syntax> &root,
+                             std::vector<Syntax *>         &nodes);
+
+private:
+    /** One level of the permutation recursion */
+    struct Frame
+    {
+        /** The children being visited or permuted */
+        std::vector<std::shared_ptr<Syntax>> *children;
+        /** The first child of the range */
+        int start;
+        /** The end of the range */
+        int end;
+        /** The recursion level */
+        int shift;
+        /** The next child to descend into, @c end to permute again */
+        int next;
+        /** Whether the range is permuted or only visited */
+        bool permuted;
+    };
+
+    /** One node permuted in the Gray code order */
+    struct Digit
+    {
+        /** The children being permuted */
+        std::vector<std::shared_ptr<Syntax>> *children;
+        /** The pre-order index of the node */
+        size_t node;
+        /** The first child of the range */
+        int start;
+        /** The number of children in the range */
+        int size;
+        /** The number of permutations, @c 0 if it does not fit */
+        uint64_t radix;
+        /** The value of the digit in the counter */
+        uint64_t position;
+        /** Inversion counters of the plain changes, indexed from 1 */
+        std::vector<int> offsets;
+        /** Directions of the plain changes, indexed from 1 */
+        std::vector<int> directions;
+    };
+
+    /**
+     * @brief      Get the children the node permutes
+     *
+     * @param      kind  The kind of the node
+     *
+     * @return     The first permuted child, @c -1 if the children are only
+     *             visited or @c -2 if the node is not descended into
+     */
+    static int getRangeStart(SyntaxKind kind);
+
+    /**
+     * @brief      Collect permuted nodes of the tree as Gray code digits
+     *
+     * @param      node     The node
+     * @param      visited  Whether the node is reachable by permutations
+     * @param      index    The pre-order index of the node, advanced past
+     *                      the subtree
+     */
+    void collectDigits(const std::shared_ptr<Syntax> &node,
+                       bool                           visited,
+                       size_t                        &index);
+
+    /**
+     * @brief      Reset the plain changes of the digit to the first
+     *             permutation
+     *
+     * @param      digit  The digit
+     */
+    static void resetDigit(Digit &digit);
+
+    /**
+     * @brief      Bring the digit to the next permutation of the plain
+     *             changes, wrapping around after the last one
+     *
+     * @param      digit  The digit
+     */
+    void stepDigit(Digit &digit);
+
+    /**
+     * @brief      Bring the tree to the next variant in the Gray code order
+     *
+     * @return     @c false if there are no more variants
+     */
+    bool nextGray();
+
+    /**
+     * @brief      Descend into the node
+     *
+     * @param      node   The node
+     * @param      shift  The shift (indicates the recursion level)
+     */
+    void pushNode(const std::shared_ptr<Syntax> &node, int shift);
+
+    /**
+     * @brief      Start permuting the children range
+     *
+     * @param      children  The syntax node children
+     * @param      start     The start index
+     * @param      end       The end index
+     * @param      shift     The shift (indicates the recursion level)
+     */
+    void pushRange(std::vector<std::shared_ptr<Syntax>> &children,
+                   int                                   start,
+                   int                                   end,
+                   int                                   shift);
+
+    /**
+     * @brief      Set the permutation order key of the node
+     *
+     * @param      shift  The recursion level of the permutation
+     * @param      node   The node
+     * @param      key    The key, nodes with equal keys are not reordered
+     */
+    void setKey(int shift, const Syntax *node, int key);
+
+    /**
+     * @brief      Get the permutation order key of the node
+     *
+     * @param      shift  The recursion level of the permutation
+     * @param      node   The node
+     *
+     * @return     The key
+     */
+    int getKey(int shift, const Syntax *node) const;
+
+    Generator         &_generator;
+    std::vector<Frame> _stack;
+    size_t             _count = 0;
+    bool               _stopped = false;
+    VariantOrder       _order = VariantOrder::Lexicographic;
+    /* Gray code digits, the last one changes most often */
+    std::vector<Digit> _digits;
+    size_t             _swapNode = 0;
+    size_t             _swapPosition = 0;
+    /* Keys are kept per recursion level so that no allocation is needed */
+    std::vector<std::vector<std::pair<const Syntax *, int>>> _keys;
+};
+}
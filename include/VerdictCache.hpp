@@ -0,0 +1,72 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include "Canonical.hpp"
+
+namespace FuzzyTest
+{
+/**
+ * @brief      Persistent map from canonical tree hashes to analyzer verdicts.
+ *
+ * The file is a header followed by fixed-size records of a 128-bit hash
+ * and a 32-bit exit status, all little-endian. Records are only appended,
+ * so a record torn by a killed process is the last one and is dropped when
+ * the file is opened again.
+ */
+class VerdictCache
+{
+public:
+    VerdictCache() = default;
+    VerdictCache(const VerdictCache &) = delete;
+    VerdictCache &operator=(const VerdictCache &) = delete;
+    ~VerdictCache();
+
+    /**
+     * @brief      Load the cache from the file, creating it if needed
+     *
+     * @param      file  The file name
+     *
+     * @return     @c false if the file can't be created or is not a cache
+     */
+    bool open(const std::string &file);
+
+    /**
+     * @brief      Look the verdict up
+     *
+     * @param      hash    The hash of the program
+     * @param      status  The exit status of the analyzer
+     *
+     * @return     @c true if the verdict is known
+     */
+    bool find(const TreeHash &hash, int &status) const;
+
+    /**
+     * @brief      Remember the verdict and append it to the file
+     *
+     * @param      hash    The hash of the program
+     * @param      status  The exit status of the analyzer
+     *
+     * @return     @c true on success
+     */
+    bool insert(const TreeHash &hash, int status);
+
+    /**
+     * @brief      Get the number of known verdicts
+     *
+     * @return     The number of verdicts
+     */
+    size_t size() const
+    {
+        return _verdicts.size();
+    }
+
+private:
+    std::FILE                                            *_file = nullptr;
+    std::unordered_map<TreeHash, int, TreeHash::Hasher>  _verdicts;
+};
+}
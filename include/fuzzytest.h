@@ -0,0 +1,117 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#ifndef FUZZYTEST_H
+#define FUZZYTEST_H
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Generated program together with its variants */
+typedef struct fuzzytest_program fuzzytest_program;
+
+/**
+ * @brief      Receives one variant rendered into the caller-owned buffer
+ *
+ * @param      context  The context passed to fuzzytest_program_variants()
+ * @param      index    The index of the variant
+ * @param      size     The full size of the variant, it is truncated if
+ *                      larger than the capacity of the buffer
+ *
+ * @return     Non-zero to stop the iteration
+ */
+typedef int (*fuzzytest_variant_callback)(void  *context,
+                                          size_t index,
+                                          size_t size);
+
+/**
+ * @brief      Generate a program
+ *
+ * @param      seed           The seed, the same as used by the command line
+ * @param      variant_limit  Maximum number of variants, 0 for no limit
+ *
+ * @return     The program or NULL on failure
+ */
+fuzzytest_program *fuzzytest_program_create(unsigned int seed,
+                                            size_t       variant_limit);
+
+/**
+ * @brief      Destroy the program
+ *
+ * @param      program  The program
+ */
+void fuzzytest_program_destroy(fuzzytest_program *program);
+
+/**
+ * @brief      Get the size of the rendered program and of each variant
+ *
+ * @param      program  The program
+ *
+ * @return     The size in bytes, without a terminating null
+ */
+size_t fuzzytest_program_size(const fuzzytest_program *program);
+
+/**
+ * @brief      Render the primary program into the buffer
+ *
+ * @param      program   The program
+ * @param      buffer    The buffer
+ * @param      capacity  The capacity of the buffer
+ *
+ * @return     The full size of the program
+ */
+size_t fuzzytest_program_render(const fuzzytest_program *program,
+                                char                    *buffer,
+                                size_t                   capacity);
+
+/**
+ * @brief      Render every variant into the buffer and report it
+ *
+ * The variants pulled so far are rewound first, so every call reports the
+ * same variants.
+ *
+ * @param      program   The program
+ * @param      buffer    The buffer reused for every variant
+ * @param      capacity  The capacity of the buffer
+ * @param      callback  The callback
+ * @param      context   The context passed to the callback
+ *
+ * @return     The number of reported variants
+ */
+size_t fuzzytest_program_variants(fuzzytest_program         *program,
+                                  char                      *buffer,
+                                  size_t                     capacity,
+                                  fuzzytest_variant_callback callback,
+                                  void                      *context);
+
+/**
+ * @brief      Bring the program to its next variant and render it
+ *
+ * @param      program   The program
+ * @param      buffer    The buffer
+ * @param      capacity  The capacity of the buffer
+ * @param      size      Receives the full size of the variant, may be NULL
+ *
+ * @return     Non-zero if a variant was rendered, zero if there are no more
+ */
+int fuzzytest_program_next_variant(fuzzytest_program *program,
+                                   char              *buffer,
+                                   size_t             capacity,
+                                   size_t            *size);
+
+/**
+ * @brief      Bring the program back to the primary state and restart the
+ *             variants pulled by fuzzytest_program_next_variant(), the same
+ *             variants are pulled again in the same order
+ *
+ * @param      program  The program
+ */
+void fuzzytest_program_rewind(fuzzytest_program *program);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,23 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "AllocationCounter.hpp"
+#include <atomic>
+
+namespace FuzzyTest
+{
+static std::atomic<size_t> allocationCount(0);
+
+void
+countAllocation()
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t
+getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+}
@@ -0,0 +1,72 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <cstdlib>
+#include <new>
+#include "AllocationCounter.hpp"
+
+/*
+ * Replacements of the global allocation functions which count every heap
+ * allocation of the application. They are linked into the command line tool
+ * only, so applications embedding the library keep their own allocator.
+ */
+
+static void *
+allocate(size_t size)
+{
+    FuzzyTest::countAllocation();
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void *
+operator new(size_t size)
+{
+    void *ptr = allocate(size);
+
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *
+operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *
+operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *
+operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void
+operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void
+operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void
+operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void
+operator delete[](void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
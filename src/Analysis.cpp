@@ -0,0 +1,129 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Analysis.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "Canonical.hpp"
+#include "Generator.hpp"
+#include "Process.hpp"
+#include "VerdictCache.hpp"
+
+namespace FuzzyTest
+{
+Analysis::Analysis(const Options &options, unsigned long long seed) :
+  _options(options), _seed(seed)
+{
+}
+
+bool
+Analysis::run(const AnalyzeOptions &analyze, const std::string &path)
+{
+    Generator    generator;
+    auto         random = std::make_shared<SeededRandomSource>(_seed);
+    VerdictCache cache;
+    std::string  file = analyze.cache.empty() ? path + "/verdicts.fzv"
+                                              : analyze.cache;
+    size_t       items = 0;
+    size_t       hits = 0;
+    size_t       runs = 0;
+    size_t       failed = 0;
+
+    if (_options.minimizeStrength != 0 && _options.variantLimit == 0)
+    {
+        std::cerr << "Minimizing needs a limit of variants" << std::endl;
+        return false;
+    }
+
+    if (!cache.open(file))
+    {
+        std::cerr << "Failed to open verdict cache " << file << std::endl;
+        return false;
+    }
+
+    /* The same sequence of random decisions as the command line takes */
+    random->next();
+    generator.setOptions(_options);
+    generator.setRandomSource(random);
+    if (!generator.prepareExpressions())
+    {
+        std::cerr << "Failed to load expressions " << _options.expressionFile
+                  << std::endl;
+        return false;
+    }
+
+    auto check = [&](const std::shared_ptr<Syntax> &root,
+                     size_t                         program,
+                     long long                      variant) {
+        TreeHash    hash = hashTree(root, analyze.command);
+        std::string name = path + "/" + std::to_string(program) + "_" +
+            (variant < 0 ? std::string("primary") : std::to_string(variant)) +
+            ".c";
+        int         status;
+        bool        cached = cache.find(hash, status);
+
+        items++;
+        if (cached)
+        {
+            hits++;
+        }
+        else
+        {
+            std::ofstream ofs(name, std::ios::binary);
+
+            ofs << root->toString();
+            ofs.close();
+
+            status = runCommand(analyze.command, name, true).status;
+            cache.insert(hash, status);
+            runs++;
+        }
+
+        if (status == 0)
+        {
+            if (!cached)
+                std::remove(name.c_str());
+            return;
+        }
+
+        /* A failing program is kept even if its verdict was cached */
+        if (cached)
+        {
+            std::ofstream ofs(name, std::ios::binary);
+
+            ofs << root->toString();
+        }
+
+        failed++;
+        std::cout << "program " << program << ", "
+                  << (variant < 0 ? std::string("primary")
+                                  : "variant " + std::to_string(variant))
+                  << ": status " << status << (cached ? " (cached)" : "")
+                  << std::endl;
+    };
+
+    for (size_t p = 0; p < _options.programs; ++p)
+    {
+        std::shared_ptr<Syntax> root =
+            _options.isLargeProgram()
+                ? generator.generateLargeProgram(_options.targetBytes,
+                                                 _options.targetNodes)
+                : generator.generateProgram();
+
+        /* Like the files, the primary program belongs to the first shard */
+        if (_options.shardIndex == 0)
+            check(root, p, -1);
+
+        generator.forEachVariant(root, [&](size_t i) { check(root, p, i); });
+    }
+
+    std::cout << "analyzed " << items << " programs and variants, " << hits
+              << " cache hits ("
+              << (items == 0 ? 0.0 : 100.0 * hits / items) << "%), " << runs
+              << " analyzer runs, " << failed << " failed, " << cache.size()
+              << " verdicts cached" << std::endl;
+    return true;
+}
+}
@@ -0,0 +1,13 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "AnalyzerHook.hpp"
+
+extern "C" int
+FuzzyTestAnalyze(const char *data, size_t size)
+{
+    (void)data;
+    (void)size;
+    return 0;
+}
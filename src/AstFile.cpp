@@ -0,0 +1,497 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "AstFile.hpp"
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace FuzzyTest
+{
+static const char   astMagic[] = { 'F', 'Z', 'A', '\0' };
+static const size_t headerSize = 40;
+
+static void
+putField(std::string &out, uint32_t value, unsigned width)
+{
+    for (unsigned i = 0; i < width; ++i)
+    {
+        out.push_back(static_cast<char>(value & 0xFF));
+        value >>= 8;
+    }
+}
+
+/**
+ * @brief      Get the number of bytes needed to hold the value
+ */
+static unsigned
+widthOf(uint32_t value)
+{
+    unsigned width = 1;
+
+    while (width < 4 && value >> (8 * width) != 0)
+        width++;
+    return width;
+}
+
+static bool
+validWidth(unsigned width)
+{
+    return width >= 1 && width <= 4;
+}
+
+/**
+ * @brief      Number nodes in pre-order and intern their values
+ */
+static void
+numberNode(const std::shared_ptr<Syntax>                   &node,
+           std::unordered_map<const Syntax *, uint32_t>    &ids,
+           std::vector<Syntax *>                           &order,
+           std::unordered_map<std::string, uint32_t>       &strings,
+           std::vector<const std::string *>                &values)
+{
+    if (node == nullptr || ids.count(node.get()) != 0)
+        return;
+
+    ids.emplace(node.get(), static_cast<uint32_t>(order.size()));
+    order.push_back(node.get());
+
+    auto it = strings.emplace(node->getStringValue(),
+                              static_cast<uint32_t>(strings.size()));
+    if (it.second)
+        values.push_back(&it.first->first);
+
+    for (auto &ch : node->children())
+    {
+        numberNode(ch, ids, order, strings, values);
+    }
+}
+
+void
+AstFile::encode(const std::shared_ptr<Syntax> &root,
+                std::string                   &out,
+                const std::string             &random)
+{
+    std::unordered_map<const Syntax *, uint32_t> ids;
+    std::vector<Syntax *>                        order;
+    std::unordered_map<std::string, uint32_t>    strings;
+    std::vector<const std::string *>             values;
+    uint32_t                                     children = 0;
+    uint32_t                                     bytes = 0;
+    unsigned                                     offsetWidth;
+    unsigned                                     valueWidth;
+    unsigned                                     childWidth;
+    unsigned                                     nodeWidth;
+    uint32_t                                     null;
+
+    numberNode(root, ids, order, strings, values);
+
+    for (auto node : order)
+        children += static_cast<uint32_t>(node->children().size());
+    for (auto value : values)
+        bytes += static_cast<uint32_t>(value->size());
+
+    /* All bits of a node index set stand for a null child */
+    offsetWidth = widthOf(bytes);
+    valueWidth = widthOf(values.empty() ? 0 : values.size() - 1);
+    childWidth = widthOf(children);
+    nodeWidth = widthOf(static_cast<uint32_t>(order.size()));
+    null = nodeWidth == 4 ? none : (1U << (8 * nodeWidth)) - 1;
+
+    out.append(astMagic, sizeof(astMagic));
+    putField(out, version, 2);
+    putField(out, 0, 2);
+    putField(out, offsetWidth, 1);
+    putField(out, valueWidth, 1);
+    putField(out, childWidth, 1);
+    putField(out, nodeWidth, 1);
+    putField(out, static_cast<uint32_t>(order.size()), 4);
+    putField(out, static_cast<uint32_t>(values.size()), 4);
+    putField(out, children, 4);
+    putField(out, bytes, 4);
+    putField(out, order.empty() ? none : 0, 4);
+    putField(out, static_cast<uint32_t>(random.size()), 4);
+    putField(out, 0, 4);
+
+    bytes = 0;
+    putField(out, 0, offsetWidth);
+    for (auto value : values)
+    {
+        bytes += static_cast<uint32_t>(value->size());
+        putField(out, bytes, offsetWidth);
+    }
+
+    children = 0;
+    for (auto node : order)
+    {
+        putField(out, static_cast<uint32_t>(node->getKind()), 1);
+        putField(out, strings[node->getStringValue()], valueWidth);
+        putField(out, children, childWidth);
+        children += static_cast<uint32_t>(node->children().size());
+    }
+
+    for (auto node : order)
+    {
+        for (auto &ch : node->children())
+            putField(out, ch == nullptr ? null : ids[ch.get()], nodeWidth);
+    }
+
+    out.append(random);
+    for (auto value : values)
+        out.append(*value);
+
+    /* Keep the next file aligned when several are concatenated */
+    out.append((4 - out.size() % 4) % 4, '\0');
+}
+
+bool
+AstFile::save(const std::shared_ptr<Syntax> &root,
+              const std::string             &file,
+              const std::string             &random)
+{
+    std::string   data;
+    std::ofstream ofs(file, std::ios::binary);
+
+    if (!ofs.is_open())
+        return false;
+
+    encode(root, data, random);
+    ofs.write(data.data(), data.size());
+    return ofs.good();
+}
+
+AstFile::~AstFile()
+{
+    close();
+}
+
+void
+AstFile::close()
+{
+    if (_map != nullptr)
+        munmap(_map, _size);
+    _map = nullptr;
+    _data = nullptr;
+    _size = 0;
+}
+
+bool
+AstFile::open(const std::string &file)
+{
+    struct stat st;
+    int         fd;
+    void       *map;
+
+    close();
+
+    fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(headerSize))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    if (!open(static_cast<const char *>(map), st.st_size))
+    {
+        munmap(map, st.st_size);
+        return false;
+    }
+    _map = map;
+    return true;
+}
+
+bool
+AstFile::open(const char *data, size_t size)
+{
+    uint64_t expected;
+
+    close();
+    if (size < headerSize || std::char_traits<char>::compare(
+                                 data, astMagic, sizeof(astMagic)) != 0)
+        return false;
+
+    _data = data;
+    _size = size;
+    _offsetWidth = field(8, 1);
+    _valueWidth = field(9, 1);
+    _childWidth = field(10, 1);
+    _nodeWidth = field(11, 1);
+    if (field(4, 2) != version || !validWidth(_offsetWidth) ||
+        !validWidth(_valueWidth) || !validWidth(_childWidth) ||
+        !validWidth(_nodeWidth))
+    {
+        _data = nullptr;
+        _size = 0;
+        return false;
+    }
+
+    _nodes = field(12);
+    _strings = field(16);
+    _children = field(20);
+    _bytes = field(24);
+    _root = field(28);
+    _random = field(32);
+    _null = _nodeWidth == 4 ? none : (1U << (8 * _nodeWidth)) - 1;
+
+    expected = headerSize +
+               _offsetWidth * (static_cast<uint64_t>(_strings) + 1) +
+               (1 + _valueWidth + _childWidth) *
+                   static_cast<uint64_t>(_nodes) +
+               _nodeWidth * static_cast<uint64_t>(_children) + _random +
+               _bytes;
+    if (expected > size || !check())
+    {
+        _data = nullptr;
+        _size = 0;
+        return false;
+    }
+    return true;
+}
+
+uint32_t
+AstFile::field(size_t offset, unsigned width) const
+{
+    const unsigned char *p =
+        reinterpret_cast<const unsigned char *>(_data + offset);
+    uint32_t             value = 0;
+
+    for (unsigned i = 0; i < width; ++i)
+        value |= static_cast<uint32_t>(p[i]) << (8 * i);
+    return value;
+}
+
+/* Sections follow each other without gaps */
+size_t
+AstFile::offsetsAt() const
+{
+    return headerSize;
+}
+
+size_t
+AstFile::nodesAt() const
+{
+    return offsetsAt() + _offsetWidth * (static_cast<size_t>(_strings) + 1);
+}
+
+size_t
+AstFile::nodeAt(uint32_t node) const
+{
+    return nodesAt() +
+           (1 + _valueWidth + _childWidth) * static_cast<size_t>(node);
+}
+
+size_t
+AstFile::childrenAt() const
+{
+    return nodeAt(_nodes);
+}
+
+size_t
+AstFile::randomAt() const
+{
+    return childrenAt() + _nodeWidth * static_cast<size_t>(_children);
+}
+
+size_t
+AstFile::dataAt() const
+{
+    return randomAt() + _random;
+}
+
+uint32_t
+AstFile::first(uint32_t node) const
+{
+    if (node == _nodes)
+        return _children;
+    return field(nodeAt(node) + 1 + _valueWidth, _childWidth);
+}
+
+bool
+AstFile::check() const
+{
+    uint32_t last = 0;
+
+    if (_root == none ? _nodes != 0 : _root >= _nodes)
+        return false;
+
+    /* Node indices must not reach the null child */
+    if (_nodes > _null)
+        return false;
+
+    if (field(offsetsAt(), _offsetWidth) != 0 ||
+        field(offsetsAt() + _offsetWidth * static_cast<size_t>(_strings),
+              _offsetWidth) != _bytes)
+        return false;
+    for (uint32_t i = 1; i <= _strings; ++i)
+    {
+        uint32_t offset = field(offsetsAt() + _offsetWidth *
+                                                  static_cast<size_t>(i),
+                                _offsetWidth);
+
+        if (offset < last)
+            return false;
+        last = offset;
+    }
+
+    last = 0;
+    for (uint32_t i = 0; i < _nodes; ++i)
+    {
+        size_t at = nodeAt(i);
+
+        if (field(at, 1) > static_cast<uint32_t>(SyntaxKind::Call) ||
+            field(at + 1, _valueWidth) >= _strings ||
+            first(i) != last || first(i + 1) < last)
+            return false;
+        last = first(i + 1);
+    }
+
+    for (uint32_t i = 0; i < _children; ++i)
+    {
+        uint32_t node = field(childrenAt() + _nodeWidth *
+                                                 static_cast<size_t>(i),
+                              _nodeWidth);
+
+        if (node != _null && node >= _nodes)
+            return false;
+    }
+
+    /* Rendering recurses into children, so a cycle must be rejected */
+    std::vector<uint8_t>                       state(_nodes, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+
+    for (uint32_t start = 0; start < _nodes; ++start)
+    {
+        if (state[start] != 0)
+            continue;
+
+        state[start] = 1;
+        stack.emplace_back(start, 0);
+        while (!stack.empty())
+        {
+            auto &top = stack.back();
+
+            if (top.second == childCount(top.first))
+            {
+                state[top.first] = 2;
+                stack.pop_back();
+                continue;
+            }
+
+            uint32_t ch = child(top.first, top.second++);
+
+            if (ch == none || state[ch] == 2)
+                continue;
+            if (state[ch] == 1)
+                return false;
+            state[ch] = 1;
+            stack.emplace_back(ch, 0);
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<Syntax>
+AstFile::load() const
+{
+    std::vector<std::shared_ptr<Syntax>> nodes(_nodes);
+    std::vector<std::string>             values(_strings);
+
+    if (_data == nullptr || _root == none)
+        return nullptr;
+
+    for (uint32_t i = 0; i < _strings; ++i)
+    {
+        size_t   at = offsetsAt() + _offsetWidth * static_cast<size_t>(i);
+        uint32_t start = field(at, _offsetWidth);
+
+        values[i].assign(_data + dataAt() + start,
+                         field(at + _offsetWidth, _offsetWidth) - start);
+    }
+
+    for (uint32_t i = 0; i < _nodes; ++i)
+    {
+        nodes[i] = Syntax::create(kind(i),
+                                  values[field(nodeAt(i) + 1, _valueWidth)]);
+    }
+
+    for (uint32_t i = 0; i < _nodes; ++i)
+    {
+        uint32_t count = childCount(i);
+
+        nodes[i]->children().reserve(count);
+        for (uint32_t j = 0; j < count; ++j)
+        {
+            uint32_t ch = child(i, j);
+
+            nodes[i]->add(ch == none ? nullptr : nodes[ch]);
+        }
+    }
+    return nodes[_root];
+}
+
+const char *
+AstFile::randomState(size_t &length) const
+{
+    length = _data == nullptr ? 0 : _random;
+    return length == 0 ? nullptr : _data + randomAt();
+}
+
+uint32_t
+AstFile::root() const
+{
+    return _root;
+}
+
+uint32_t
+AstFile::nodeCount() const
+{
+    return _nodes;
+}
+
+SyntaxKind
+AstFile::kind(uint32_t node) const
+{
+    return static_cast<SyntaxKind>(field(nodeAt(node), 1));
+}
+
+const char *
+AstFile::value(uint32_t node, size_t &length) const
+{
+    uint32_t string = field(nodeAt(node) + 1, _valueWidth);
+    size_t   at = offsetsAt() + _offsetWidth * static_cast<size_t>(string);
+    uint32_t start = field(at, _offsetWidth);
+
+    length = field(at + _offsetWidth, _offsetWidth) - start;
+    return _data + dataAt() + start;
+}
+
+uint32_t
+AstFile::childCount(uint32_t node) const
+{
+    return first(node + 1) - first(node);
+}
+
+uint32_t
+AstFile::child(uint32_t node, uint32_t index) const
+{
+    uint32_t ch = field(childrenAt() + _nodeWidth *
+                                           (static_cast<size_t>(first(node)) +
+                                            index),
+                        _nodeWidth);
+
+    return ch == _null ? none : ch;
+}
+}
@@ -0,0 +1,179 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Benchmark.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include "Generator.hpp"
+#include "Process.hpp"
+
+namespace FuzzyTest
+{
+struct ProgramShape
+{
+    /** The name of the shape */
+    const char *name;
+    /** The shape parameter used for the smallest program */
+    size_t      base;
+    /** Apply the shape parameter to the options */
+    void (*apply)(Options &options, size_t parameter);
+};
+
+static const ProgramShape programShapes[] = {
+    /* Many functions with random obfuscations */
+    { "functions", 4096,
+      [](Options &options, size_t parameter) {
+          options.targetBytes = parameter;
+      } },
+    /* Deeply nested obfuscation of a single goal */
+    { "depth", 4,
+      [](Options &options, size_t parameter) {
+          options.obfuscationDepth = parameter;
+      } },
+    /* Single switch with many cases */
+    { "switch", 4,
+      [](Options &options, size_t parameter) {
+          options.obfuscationDepth = 1;
+          options.obfuscationBranch = 4;
+          options.switchCases = parameter;
+      } },
+    /* Single if group with many branches */
+    { "ifgroup", 4,
+      [](Options &options, size_t parameter) {
+          options.obfuscationDepth = 1;
+          options.obfuscationBranch = 3;
+          options.ifGroupLength = parameter;
+      } },
+};
+
+Benchmark::Benchmark(const Options &options, unsigned long long seed) :
+  _options(options), _seed(seed)
+{
+}
+
+double
+Benchmark::fitExponent(const std::vector<double> &x,
+                       const std::vector<double> &y)
+{
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    size_t n = 0;
+
+    for (size_t i = 0; i < x.size() && i < y.size(); ++i)
+    {
+        if (x[i] <= 0 || y[i] <= 0)
+            continue;
+
+        double lx = std::log(x[i]);
+        double ly = std::log(y[i]);
+
+        sx += lx;
+        sy += ly;
+        sxx += lx * lx;
+        sxy += lx * ly;
+        n++;
+    }
+
+    if (n < 2 || n * sxx - sx * sx == 0)
+        return 0;
+    return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+bool
+Benchmark::sweep(const SweepOptions &sweep, const std::string &path)
+{
+    std::ofstream csv(path + "/sweep.csv");
+    std::ofstream fit(path + "/sweep_fit.csv");
+    std::shared_ptr<const ExpressionLibrary> expressions;
+
+    if (!csv.is_open() || !fit.is_open())
+        return false;
+
+    /* Shapes don't touch the options the library is built from */
+    if (!Generator::loadExpressions(_options, expressions))
+        return false;
+
+    csv << "shape,parameter,bytes,nodes,repeat,wall_seconds,peak_rss_kb,"
+           "status"
+        << std::endl;
+    fit << "shape,time_exponent,rss_exponent" << std::endl;
+
+    for (auto &shape : programShapes)
+    {
+        std::vector<double> sizes;
+        std::vector<double> times;
+        std::vector<double> memory;
+
+        for (unsigned k = 0; k < sweep.steps; ++k)
+        {
+            Options   options = _options;
+            Generator generator;
+            size_t    parameter = static_cast<size_t>(
+                std::llround(shape.base * std::pow(sweep.factor, k)));
+            std::string file = path + "/sweep_" + shape.name + "_" +
+                std::to_string(k) + ".c";
+            std::vector<double> runTimes;
+            long                peakRss = 0;
+
+            options.targetBytes = 0;
+            options.targetNodes = 0;
+            shape.apply(options, parameter);
+            generator.setOptions(options);
+            generator.setExpressions(expressions);
+
+            /* Every program of the sweep is reproducible on its own */
+            std::srand(_seed + k);
+            std::rand();
+
+            auto root = options.isLargeProgram()
+                ? generator.generateLargeProgram(options.targetBytes,
+                                                 options.targetNodes)
+                : generator.generateProgram();
+
+            if (root == nullptr)
+                return false;
+
+            auto text = root->toString();
+            auto nodes = root->countNodes();
+            {
+                std::ofstream ofs(file);
+
+                ofs << text;
+            }
+
+            for (unsigned rep = 0; rep < sweep.repeat; ++rep)
+            {
+                auto result = runCommand(sweep.command, file);
+
+                csv << shape.name << "," << parameter << "," << text.size()
+                    << "," << nodes << "," << rep << "," << result.wallSeconds
+                    << "," << result.peakRssKb << "," << result.status
+                    << std::endl;
+                runTimes.push_back(result.wallSeconds);
+                peakRss = std::max(peakRss, result.peakRssKb);
+            }
+
+            /* Median is less sensitive to the noise than mean */
+            if (!runTimes.empty())
+            {
+                std::sort(runTimes.begin(), runTimes.end());
+                sizes.push_back(text.size());
+                times.push_back(runTimes[runTimes.size() / 2]);
+                memory.push_back(peakRss);
+            }
+        }
+
+        double timeExponent = fitExponent(sizes, times);
+        double rssExponent = fitExponent(sizes, memory);
+
+        fit << shape.name << "," << timeExponent << "," << rssExponent
+            << std::endl;
+        std::cout << shape.name << ": time ~ size^" << timeExponent
+                  << ", peak RSS ~ size^" << rssExponent << std::endl;
+    }
+    return true;
+}
+}
@@ -0,0 +1,223 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Canonical.hpp"
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include "Serialization.hpp"
+
+namespace FuzzyTest
+{
+std::string
+TreeHash::toString() const
+{
+    char buffer[33];
+
+    std::snprintf(buffer, sizeof(buffer), "%016llx%016llx",
+                  static_cast<unsigned long long>(high),
+                  static_cast<unsigned long long>(low));
+    return buffer;
+}
+
+/** Names given in the order of the first declaration or use */
+using Names = std::unordered_map<std::string, std::string>;
+
+static const std::string &
+rename(Names &names, const std::string &name)
+{
+    auto it = names.find(name);
+
+    if (it != names.end())
+        return it->second;
+
+    /* Program entry is called by its name, so it must keep it */
+    if (name == "main")
+        return name;
+
+    return names.emplace(name, "v" + std::to_string(names.size()))
+        .first->second;
+}
+
+/**
+ * @brief      Append the integer literal in a form keeping its C type, or as
+ *             is if it is not a plain integer
+ *
+ * The type of an integer constant depends on its value, on whether it is
+ * decimal or not, and on its suffix: @c 0xFFFFFFFF is @c unsigned @c int,
+ * while @c 4294967295 is @c long. Hexadecimal and octal constants follow the
+ * same rules, so they are both written in hexadecimal, decimal ones stay
+ * decimal, and suffixes are spelled @c u, @c l and @c ll in this order.
+ */
+static void
+putLiteral(const std::string &value, std::string &out)
+{
+    char               buffer[32];
+    char              *end;
+    unsigned long long number;
+    bool               isUnsigned = false;
+    int                longs = 0;
+
+    if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0])))
+    {
+        out.append(value);
+        return;
+    }
+
+    errno = 0;
+    number = std::strtoull(value.c_str(), &end, 0);
+    if (errno != 0)
+    {
+        out.append(value);
+        return;
+    }
+
+    for (; *end != '\0'; ++end)
+    {
+        if ((*end == 'u' || *end == 'U') && !isUnsigned)
+            isUnsigned = true;
+        else if ((*end == 'l' || *end == 'L') && longs < 2)
+            longs++;
+        else
+            break;
+    }
+
+    if (*end != '\0')
+    {
+        out.append(value);
+        return;
+    }
+
+    /* A lone 0 is octal, but it is an int whatever its base is */
+    if (value[0] == '0' && number != 0)
+        std::snprintf(buffer, sizeof(buffer), "0x%llx", number);
+    else
+        std::snprintf(buffer, sizeof(buffer), "%llu", number);
+
+    out.append(buffer);
+    if (isUnsigned)
+        out.push_back('u');
+    out.append(longs, 'l');
+}
+
+/**
+ * @brief      Append the exact text with declared names renamed
+ */
+static void
+putExact(Names &names, const std::string &value, std::string &out)
+{
+    size_t pos = 0;
+
+    while (pos < value.size())
+    {
+        char c = value[pos];
+
+        if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_')
+        {
+            out.push_back(c);
+            pos++;
+            continue;
+        }
+
+        size_t start = pos;
+
+        while (pos < value.size() &&
+               (std::isalnum(static_cast<unsigned char>(value[pos])) ||
+                value[pos] == '_'))
+            pos++;
+
+        std::string word = value.substr(start, pos - start);
+        auto        it = names.find(word);
+
+        out.append(it != names.end() ? it->second : word);
+    }
+}
+
+static void
+canonicalizeNode(const std::shared_ptr<Syntax> &node,
+                 Names                         &names,
+                 std::string                   &out)
+{
+    std::string value;
+
+    if (node == nullptr)
+    {
+        out.push_back(static_cast<char>(0xFF));
+        return;
+    }
+
+    out.push_back(static_cast<char>(node->getKind()));
+
+    switch (node->getKind())
+    {
+        case SyntaxKind::Identifier:
+        case SyntaxKind::Call:
+        {
+            value = rename(names, node->getStringValue());
+            break;
+        }
+        case SyntaxKind::Literal:
+        {
+            putLiteral(node->getStringValue(), value);
+            break;
+        }
+        case SyntaxKind::Exact:
+        {
+            putExact(names, node->getStringValue(), value);
+            break;
+        }
+        default:
+        {
+            value = node->getStringValue();
+        }
+    }
+
+    putVarint(out, value.size());
+    out.append(value);
+
+    putVarint(out, node->children().size());
+    for (auto &ch : node->children())
+    {
+        canonicalizeNode(ch, names, out);
+    }
+}
+
+void
+canonicalize(const std::shared_ptr<Syntax> &root, std::string &out)
+{
+    Names names;
+
+    canonicalizeNode(root, names, out);
+}
+
+TreeHash
+hashTree(const std::shared_ptr<Syntax> &root, const std::string &salt)
+{
+    /* FNV-1a with the 128-bit offset basis and prime */
+    const unsigned __int128 prime =
+        (static_cast<unsigned __int128>(0x0000000001000000ULL) << 64) |
+        0x000000000000013BULL;
+    unsigned __int128 state =
+        (static_cast<unsigned __int128>(0x6C62272E07BB0142ULL) << 64) |
+        0x62B821756295C58DULL;
+    std::string data;
+    TreeHash    hash;
+
+    putVarint(data, salt.size());
+    data.append(salt);
+    canonicalize(root, data);
+
+    for (char c : data)
+    {
+        state ^= static_cast<uint8_t>(c);
+        state *= prime;
+    }
+
+    hash.high = static_cast<uint64_t>(state >> 64);
+    hash.low = static_cast<uint64_t>(state);
+    return hash;
+}
+}
@@ -0,0 +1,114 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Checkpoint.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include "Serialization.hpp"
+
+namespace FuzzyTest
+{
+static const char    checkpointMagic[] = { 'F', 'Z', 'K' };
+static const uint8_t checkpointVersion = 2;
+
+static void
+putString(std::string &out, const std::string &value)
+{
+    putVarint(out, value.size());
+    out.append(value);
+}
+
+static bool
+getString(const char *&pos, const char *end, std::string &value)
+{
+    uint64_t length;
+
+    if (!getVarint(pos, end, length) ||
+        length > static_cast<uint64_t>(end - pos))
+        return false;
+
+    value.assign(pos, length);
+    pos += length;
+    return true;
+}
+
+bool
+Checkpoint::save(const std::string &file) const
+{
+    std::string data(checkpointMagic, sizeof(checkpointMagic));
+    std::string temporary = file + ".tmp";
+    const char *pos;
+    size_t      left;
+    int         fd;
+
+    data.push_back(static_cast<char>(checkpointVersion));
+    putString(data, fingerprint);
+    putVarint(data, program);
+    putString(data, startRandom);
+    putVarint(data, variant);
+    putVarint(data, outputSize);
+    putVarint(data, swapsSize);
+    putString(data, random);
+    putString(data, ordering);
+    putString(data, stream);
+
+    fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    pos = data.data();
+    left = data.size();
+    while (left > 0)
+    {
+        ssize_t written = write(fd, pos, left);
+
+        if (written <= 0)
+        {
+            close(fd);
+            return false;
+        }
+        pos += written;
+        left -= written;
+    }
+
+    /* The rename must not overtake the data */
+    if (fsync(fd) != 0 || close(fd) != 0)
+        return false;
+    return std::rename(temporary.c_str(), file.c_str()) == 0;
+}
+
+bool
+Checkpoint::load(const std::string &file)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    std::string   data;
+
+    if (!ifs.is_open())
+        return false;
+
+    data.assign(std::istreambuf_iterator<char>(ifs),
+                std::istreambuf_iterator<char>());
+
+    const char *pos = data.data();
+    const char *end = data.data() + data.size();
+
+    if (data.size() < sizeof(checkpointMagic) + 1 ||
+        std::memcmp(pos, checkpointMagic, sizeof(checkpointMagic)) != 0 ||
+        static_cast<uint8_t>(pos[sizeof(checkpointMagic)]) !=
+            checkpointVersion)
+        return false;
+    pos += sizeof(checkpointMagic) + 1;
+
+    return getString(pos, end, fingerprint) &&
+        getVarint(pos, end, program) && getString(pos, end, startRandom) &&
+        getVarint(pos, end, variant) && getVarint(pos, end, outputSize) &&
+        getVarint(pos, end, swapsSize) &&
+        getString(pos, end, random) && getString(pos, end, ordering) &&
+        getString(pos, end, stream) && pos == end;
+}
+}
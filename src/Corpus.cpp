@@ -0,0 +1,223 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Corpus.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "Generator.hpp"
+#include "Serialization.hpp"
+
+namespace FuzzyTest
+{
+static const char   corpusMagic[] = { 'F', 'Z', 'C' };
+static const uint8_t corpusVersion = 1;
+
+Corpus::Corpus(std::shared_ptr<Syntax> root) : _root(root)
+{
+    collect(_root);
+}
+
+void
+Corpus::collect(const std::shared_ptr<Syntax> &node)
+{
+    int start;
+
+    if (node == nullptr)
+        return;
+
+    start = Generator::getPermutationStart(node->getKind());
+
+    /* Only nodes with at least two permuted children may ever change */
+    if (start >= 0 &&
+        node->children().size() >= static_cast<size_t>(start) + 2)
+    {
+        _nodes.push_back({ node, static_cast<size_t>(start),
+                           std::vector<std::shared_ptr<Syntax>>(
+                               node->children().begin() + start,
+                               node->children().end()),
+                           {} });
+
+        auto &n = _nodes.back();
+
+        n.positions.reserve(n.primary.size());
+        for (size_t j = 0; j < n.primary.size(); ++j)
+        {
+            n.positions.emplace(n.primary[j].get(),
+                                static_cast<uint32_t>(j));
+        }
+    }
+
+    for (auto &ch : node->children())
+    {
+        collect(ch);
+    }
+}
+
+void
+Corpus::encodePrimary(std::string &out) const
+{
+    out.append(corpusMagic, sizeof(corpusMagic));
+    out.push_back(static_cast<char>(corpusVersion));
+    serializeTree(_root, out);
+}
+
+void
+Corpus::encodeVariant(size_t index, std::string &out) const
+{
+    size_t changed = 0;
+    size_t last = 0;
+
+    putVarint(out, index);
+
+    for (auto &n : _nodes)
+    {
+        if (!std::equal(n.primary.begin(), n.primary.end(),
+                        n.node->children().begin() + n.start))
+            changed++;
+    }
+    putVarint(out, changed);
+
+    for (size_t i = 0; i < _nodes.size(); ++i)
+    {
+        auto &n = _nodes[i];
+        auto &children = n.node->children();
+
+        if (std::equal(n.primary.begin(), n.primary.end(),
+                       children.begin() + n.start))
+            continue;
+
+        /* Node indices are delta-encoded to keep them short */
+        putVarint(out, i - last);
+        last = i;
+
+        for (size_t j = n.start; j < children.size(); ++j)
+            putVarint(out, n.positions.at(children[j].get()));
+    }
+}
+
+bool
+Corpus::decodeVariant(const char *&pos, const char *end, size_t &index)
+{
+    uint64_t value;
+    uint64_t changed;
+    size_t   node = 0;
+
+    if (!getVarint(pos, end, value) || !getVarint(pos, end, changed))
+        return false;
+    index = value;
+
+    restorePrimary();
+    for (uint64_t i = 0; i < changed; ++i)
+    {
+        if (!getVarint(pos, end, value) || value >= _nodes.size() - node)
+        {
+            restorePrimary();
+            return false;
+        }
+        node += value;
+
+        auto &n = _nodes[node];
+        auto &children = n.node->children();
+
+        /* Every child must be placed exactly once, or it would be lost */
+        _used.assign(n.primary.size(), 0);
+        for (size_t j = n.start; j < children.size(); ++j)
+        {
+            if (!getVarint(pos, end, value) || value >= n.primary.size() ||
+                _used[value] != 0)
+            {
+                restorePrimary();
+                return false;
+            }
+            _used[value] = 1;
+            children[j] = n.primary[value];
+        }
+    }
+    return true;
+}
+
+void
+Corpus::restorePrimary()
+{
+    for (auto &n : _nodes)
+    {
+        std::copy(n.primary.begin(), n.primary.end(),
+                  n.node->children().begin() + n.start);
+    }
+}
+
+bool
+Corpus::getOrder(size_t node, std::vector<uint32_t> &order) const
+{
+    auto &n = _nodes[node];
+    auto &children = n.node->children();
+
+    order.clear();
+    if (std::equal(n.primary.begin(), n.primary.end(),
+                   children.begin() + n.start))
+        return false;
+
+    for (size_t j = n.start; j < children.size(); ++j)
+        order.push_back(n.positions.at(children[j].get()));
+    return true;
+}
+
+std::shared_ptr<Syntax>
+Corpus::decodePrimary(const char *&pos, const char *end)
+{
+    if (static_cast<size_t>(end - pos) < sizeof(corpusMagic) + 1 ||
+        std::memcmp(pos, corpusMagic, sizeof(corpusMagic)) != 0 ||
+        static_cast<uint8_t>(pos[sizeof(corpusMagic)]) != corpusVersion)
+        return nullptr;
+
+    pos += sizeof(corpusMagic) + 1;
+    return deserializeTree(pos, end);
+}
+
+bool
+Corpus::expand(const std::string &file,
+               const std::string &path,
+               long long          variant)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    std::string   data;
+    size_t        index;
+
+    if (!ifs.is_open())
+        return false;
+
+    data.assign(std::istreambuf_iterator<char>(ifs),
+                std::istreambuf_iterator<char>());
+
+    const char *pos = data.data();
+    const char *end = data.data() + data.size();
+
+    auto root = decodePrimary(pos, end);
+    if (root == nullptr)
+        return false;
+
+    if (variant < 0)
+    {
+        std::ofstream prim(path + "/_primary.c");
+        prim << root->toString();
+    }
+
+    Corpus corpus(root);
+    while (pos < end)
+    {
+        if (!corpus.decodeVariant(pos, end, index))
+            return false;
+
+        if (variant < 0 || static_cast<size_t>(variant) == index)
+        {
+            std::ofstream ofs(path + "/" + std::to_string(index) + ".c");
+
+            ofs << root->toString();
+        }
+    }
+    return true;
+}
+}
@@ -0,0 +1,466 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "ExpressionLibrary.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace FuzzyTest
+{
+static const char *const classNames[] = { "value", "true", "false" };
+
+/* Loaded templates are reduced recursively, so their size is bounded */
+static const size_t maxCells = 4096;
+
+/**
+ * @brief      Builds templates with the shapes of
+ *             Generator::getExpressionEvaluatingToValue() and
+ *             Generator::getAlwaysExpression()
+ */
+struct ExpressionLibrary::Builder
+{
+    std::mt19937 random;
+    int          literalPercent;
+
+    uint32_t next(uint32_t bound)
+    {
+        return random() % bound;
+    }
+
+    /* The same range as the values of the generator */
+    uint32_t nextValue()
+    {
+        return random() >> 1;
+    }
+
+    void leaf(Template &cells, Affine target, const char *spelling)
+    {
+        if (target.a != 0)
+            cells.push_back({ Cell::Hole, "", target.a, target.c });
+        else if (spelling != nullptr)
+            cells.push_back({ Cell::Constant, spelling, 0, target.c });
+        else
+            cells.push_back({ Cell::Constant, std::to_string(target.c), 0,
+                              target.c });
+    }
+
+    void value(Template &cells, Affine target, const char *spelling = nullptr)
+    {
+        uint32_t r;
+        uint32_t k;
+
+        if (literalPercent < 0)
+            r = next(10);
+        else
+            r = (static_cast<int>(next(100)) < literalPercent) ? 0
+                                                               : 6 + next(4);
+
+        switch (r)
+        {
+            case 6:
+            {
+                /* Trivial minus */
+                k = nextValue();
+                cells.push_back({ Cell::Operator, "-", 0, 0 });
+                value(cells, { target.a, target.c + k });
+                value(cells, { 0, k });
+                break;
+            }
+            case 7:
+            {
+                /* Trivial plus */
+                k = nextValue();
+                cells.push_back({ Cell::Operator, "+", 0, 0 });
+                value(cells, { target.a, target.c - k });
+                value(cells, { 0, k });
+                break;
+            }
+            case 8:
+            {
+                /* Trivial & 0xFFFFFFFF */
+                cells.push_back({ Cell::Operator, "&", 0, 0 });
+                leaf(cells, target, spelling);
+                value(cells, { 0, 0xFFFFFFFF }, "0xFFFFFFFF");
+                break;
+            }
+            case 9:
+            {
+                /* Trivial ^ rand ^ rand */
+                cells.push_back({ Cell::Operator, "^", 0, 0 });
+                leaf(cells, target, spelling);
+                cells.push_back({ Cell::Operator, "^", 0, 0 });
+                value(cells, target, spelling);
+                value(cells, target, spelling);
+                break;
+            }
+            default:
+            {
+                leaf(cells, target, spelling);
+            }
+        }
+    }
+
+    void predicate(Template &cells, bool truth)
+    {
+        if (next(2) == 0)
+        {
+            /* Trivial */
+            const char *ops[] = { "==", ">=", "<=" };
+            const char *negops[] = { "!=", "<", ">" };
+            uint32_t    r = next(3);
+
+            cells.push_back({ Cell::Operator, truth ? ops[r] : negops[r], 0,
+                              0 });
+            value(cells, { 1, 0 });
+            cells.push_back({ Cell::Same, "", 0, 0 });
+        }
+        else
+        {
+            /* At least with different values */
+            uint32_t delta = 1 + next(0xFFFFFFFF);
+
+            cells.push_back({ Cell::Operator, truth ? "!=" : "==", 0, 0 });
+            value(cells, { 1, 0 });
+            value(cells, { 1, delta });
+        }
+    }
+};
+
+void
+ExpressionLibrary::build(size_t count, int literalPercent, uint64_t seed)
+{
+    Builder builder = { std::mt19937(static_cast<uint32_t>(seed)),
+                        literalPercent };
+
+    for (auto &templates : _templates)
+        templates.clear();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Template cells;
+
+        builder.value(cells, { 1, 0 });
+        _templates[static_cast<size_t>(ExpressionClass::Value)].push_back(
+            std::move(cells));
+
+        builder.predicate(cells, true);
+        _templates[static_cast<size_t>(ExpressionClass::True)].push_back(
+            std::move(cells));
+
+        builder.predicate(cells, false);
+        _templates[static_cast<size_t>(ExpressionClass::False)].push_back(
+            std::move(cells));
+    }
+}
+
+bool
+ExpressionLibrary::evaluate(const Template &cells, size_t &pos, Affine &value)
+{
+    Affine left;
+    Affine right;
+
+    if (pos >= cells.size())
+        return false;
+
+    const Cell &cell = cells[pos++];
+
+    switch (cell.kind)
+    {
+        case Cell::Hole:
+        case Cell::Constant:
+        {
+            value = { cell.a, cell.c };
+            return true;
+        }
+        case Cell::Same:
+        {
+            return false;
+        }
+        case Cell::Operator:
+        {
+            break;
+        }
+    }
+
+    if (!evaluate(cells, pos, left) || !evaluate(cells, pos, right))
+        return false;
+
+    /* Only the identities the generator relies on are accepted */
+    if (cell.text == "+")
+    {
+        value = { left.a + right.a, left.c + right.c };
+    }
+    else if (cell.text == "-")
+    {
+        value = { left.a - right.a, left.c - right.c };
+    }
+    else if (cell.text == "&" && right.a == 0 && right.c == 0xFFFFFFFF)
+    {
+        value = left;
+    }
+    else if (cell.text == "&" && left.a == 0 && right.a == 0)
+    {
+        value = { 0, left.c & right.c };
+    }
+    else if (cell.text == "^" && left.a == right.a && left.c == right.c)
+    {
+        value = { 0, 0 };
+    }
+    else if (cell.text == "^" && right.a == 0 && right.c == 0)
+    {
+        value = left;
+    }
+    else if (cell.text == "^" && left.a == 0 && right.a == 0)
+    {
+        value = { 0, left.c ^ right.c };
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool
+ExpressionLibrary::validate(const Template &cells, ExpressionClass kind)
+{
+    size_t pos = 0;
+    Affine left;
+    Affine right;
+    bool   truth;
+
+    if (kind == ExpressionClass::Value)
+    {
+        return evaluate(cells, pos, left) && pos == cells.size() &&
+            left.a == 1 && left.c == 0;
+    }
+
+    if (cells.empty() || cells[0].kind != Cell::Operator)
+        return false;
+
+    const std::string &op = cells[0].text;
+
+    pos = 1;
+    if (!evaluate(cells, pos, left) || pos >= cells.size())
+        return false;
+
+    if (cells[pos].kind == Cell::Same)
+    {
+        /* Equal expressions compare equal in any integer type */
+        pos++;
+        if (op == "==" || op == ">=" || op == "<=")
+            truth = true;
+        else if (op == "!=" || op == "<" || op == ">")
+            truth = false;
+        else
+            return false;
+    }
+    else
+    {
+        /*
+         * Different values modulo 2^32 are different in any wider type too,
+         * equal ones may not be, so they only come from the same expression.
+         */
+        if (!evaluate(cells, pos, right) || left.a != right.a ||
+            left.c == right.c)
+            return false;
+
+        if (op == "!=")
+            truth = true;
+        else if (op == "==")
+            truth = false;
+        else
+            return false;
+    }
+
+    return pos == cells.size() &&
+        truth == (kind == ExpressionClass::True);
+}
+
+std::shared_ptr<Syntax>
+ExpressionLibrary::instantiate(const Template &cells,
+                               size_t         &pos,
+                               uint32_t        value)
+{
+    const Cell &cell = cells[pos++];
+
+    if (cell.kind == Cell::Hole)
+    {
+        return Syntax::create(SyntaxKind::Literal,
+                              std::to_string(cell.a * value + cell.c));
+    }
+    if (cell.kind != Cell::Operator)
+        return Syntax::create(SyntaxKind::Literal, cell.text);
+
+    auto left = instantiate(cells, pos, value);
+    auto right = instantiate(cells, pos, value);
+
+    return Syntax::create(SyntaxKind::Binary, cell.text, left, right);
+}
+
+std::shared_ptr<Syntax>
+ExpressionLibrary::instantiate(ExpressionClass kind,
+                               size_t          index,
+                               uint32_t        value) const
+{
+    const Template &cells = _templates[static_cast<size_t>(kind)][index];
+    size_t          pos = 0;
+
+    if (kind == ExpressionClass::Value)
+        return instantiate(cells, pos, value);
+
+    pos = 1;
+    auto left = instantiate(cells, pos, value);
+    auto right = (cells[pos].kind == Cell::Same)
+        ? left
+        : instantiate(cells, pos, value);
+
+    return Syntax::create(SyntaxKind::Binary, cells[0].text, left, right);
+}
+
+/**
+ * @brief      Parse an unsigned 32-bit number written in any C base
+ */
+static bool
+parseValue(const std::string &text, uint32_t &value)
+{
+    char              *end;
+    unsigned long long number;
+
+    if (text.empty() || text[0] == '-')
+        return false;
+
+    errno = 0;
+    number = std::strtoull(text.c_str(), &end, 0);
+    if (errno != 0 || *end != '\0' || number > 0xFFFFFFFFULL)
+        return false;
+
+    value = static_cast<uint32_t>(number);
+    return true;
+}
+
+bool
+ExpressionLibrary::load(const std::string &file)
+{
+    std::ifstream ifs(file);
+    std::string   line;
+
+    if (!ifs.is_open())
+        return false;
+
+    for (auto &templates : _templates)
+        templates.clear();
+
+    while (std::getline(ifs, line))
+    {
+        std::istringstream iss(line);
+        std::string        token;
+        size_t             kind = 0;
+        Template           cells;
+
+        if (!(iss >> token) || token[0] == '#')
+            continue;
+
+        while (kind < static_cast<size_t>(ExpressionClass::Count) &&
+               token != classNames[kind])
+            kind++;
+        if (kind == static_cast<size_t>(ExpressionClass::Count))
+            return false;
+
+        while (iss >> token)
+        {
+            Cell   cell = { Cell::Operator, token, 0, 0 };
+            size_t colon = token.find(':', 2);
+
+            if (token == "@")
+            {
+                cell.kind = Cell::Same;
+                cell.text.clear();
+            }
+            else if (token.compare(0, 2, "k:") == 0)
+            {
+                cell.kind = Cell::Constant;
+                cell.text = token.substr(2);
+                if (!parseValue(cell.text, cell.c))
+                    return false;
+            }
+            else if (token.compare(0, 2, "h:") == 0)
+            {
+                cell.kind = Cell::Hole;
+                cell.text.clear();
+                if (colon == std::string::npos ||
+                    !parseValue(token.substr(2, colon - 2), cell.a) ||
+                    !parseValue(token.substr(colon + 1), cell.c))
+                    return false;
+            }
+            else if (std::strchr("+-&^", token[0]) == nullptr &&
+                     token != "==" && token != "!=" && token != "<=" &&
+                     token != ">=" && token != "<" && token != ">")
+            {
+                return false;
+            }
+
+            cells.push_back(std::move(cell));
+            if (cells.size() > maxCells)
+                return false;
+        }
+
+        if (!validate(cells, static_cast<ExpressionClass>(kind)))
+            return false;
+        _templates[kind].push_back(std::move(cells));
+    }
+
+    /* Every class is needed by the generator */
+    for (auto &templates : _templates)
+    {
+        if (templates.empty())
+            return false;
+    }
+    return true;
+}
+
+bool
+ExpressionLibrary::save(const std::string &file) const
+{
+    std::ofstream ofs(file);
+
+    if (!ofs.is_open())
+        return false;
+
+    ofs << "# FuzzyTest expression templates" << std::endl;
+    for (size_t kind = 0; kind < static_cast<size_t>(ExpressionClass::Count);
+         ++kind)
+    {
+        for (auto &cells : _templates[kind])
+        {
+            ofs << classNames[kind];
+            for (auto &cell : cells)
+            {
+                ofs << ' ';
+                switch (cell.kind)
+                {
+                    case Cell::Operator:
+                        ofs << cell.text;
+                        break;
+                    case Cell::Constant:
+                        ofs << "k:" << cell.text;
+                        break;
+                    case Cell::Hole:
+                        ofs << "h:" << cell.a << ':' << cell.c;
+                        break;
+                    case Cell::Same:
+                        ofs << '@';
+                        break;
+                }
+            }
+            ofs << std::endl;
+        }
+    }
+    return ofs.good();
+}
+}
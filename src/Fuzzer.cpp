@@ -0,0 +1,48 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "AnalyzerHook.hpp"
+#include "Generator.hpp"
+
+using namespace FuzzyTest;
+
+/* Variants analyzed per input, more of them lower the exec/s */
+static const size_t fuzzerVariantLimit = 8;
+
+static void
+analyze(const std::string &program)
+{
+    FuzzyTestAnalyze(program.data(), program.size());
+}
+
+extern "C" int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static std::string buffer;
+    Generator          generator;
+    size_t             i = 0;
+
+    /* Every generator decision is taken from the fuzzer input */
+    generator.setRandomSource(
+        std::make_shared<ByteStreamRandomSource>(data, size));
+
+    auto root = generator.generateProgram();
+
+    buffer.clear();
+    root->render(buffer);
+    analyze(buffer);
+
+    VariantStream stream(generator, root);
+
+    while (i++ < fuzzerVariantLimit && stream.next())
+    {
+        buffer.clear();
+        root->render(buffer);
+        analyze(buffer);
+    }
+    return 0;
+}
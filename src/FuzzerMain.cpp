@@ -0,0 +1,37 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+/*
+ * Driver for compilers without libFuzzer: runs the fuzzing entry point on
+ * every file given on the command line, e.g. to reproduce a crash.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int
+main(int argc, const char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream ifs(argv[i], std::ios::binary);
+        std::string   data;
+
+        if (!ifs.is_open())
+        {
+            std::cerr << "Failed to open " << argv[i] << std::endl;
+            return 1;
+        }
+
+        data.assign(std::istreambuf_iterator<char>(ifs),
+                    std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(data.data()),
+                               data.size());
+    }
+    return 0;
+}
@@ -4,50 +4,47 @@
  */
 #include "Generator.hpp"
 #include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <fcntl.h>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <map>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "AllocationCounter.hpp"
+#include "AstFile.hpp"
+#include "Checkpoint.hpp"
+#include "Corpus.hpp"
+#include "ExpressionLibrary.hpp"
+#include "Minimizer.hpp"
+#include "ParallelRenderer.hpp"
+#include "PerfCounters.hpp"
+#include "Serialization.hpp"
 #include "Syntax.hpp"
 
 namespace FuzzyTest
 {
 std::string
-Generator::generateString(size_t length)
+Generator::generateName()
 {
-    auto randchar = []() -> char {
-        const char charset[] = "0123456789"
-                               "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                               "abcdefghijklmnopqrstuvwxyz";
-        const size_t max_index = (sizeof(charset) - 1);
-        return charset[rand() % max_index];
-    };
-    auto randcharSymbol = []() -> char {
-        const char charset[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                               "abcdefghijklmnopqrstuvwxyz";
-        const size_t max_index = (sizeof(charset) - 1);
-        return charset[rand() % max_index];
-    };
-    std::string str(length, 0);
-    std::generate_n(str.begin(), 1, randcharSymbol);
-    std::generate_n(str.begin() + 1, length - 1, randchar);
-    return str;
+    return _names.next();
 }
 
 std::string
-Generator::generateValue(std::string type)
+Generator::generateValue(const std::string &type)
 {
     if (type == "uint32_t")
     {
-        return std::to_string(std::rand());
+        return std::to_string(random());
     }
     return "";
 }
 
 std::shared_ptr<Syntax>
-Generator::pickRandomVar(std::vector<std::vector<std::shared_ptr<Syntax>>> vars)
+Generator::pickRandomVar(
+    const std::vector<std::vector<std::shared_ptr<Syntax>>> &vars)
 {
     int r;
     int retries = 0;
@@ -57,7 +54,7 @@ Generator::pickRandomVar(std::vector<std::vector<std::shared_ptr<Syntax>>> vars)
 
     while (true)
     {
-        r = (std::rand() % vars.size());
+        r = random(vars.size());
 
         if (vars[r].size() != 0 || retries == 10)
             break;
@@ -68,17 +65,69 @@ Generator::pickRandomVar(std::vector<std::vector<std::shared_ptr<Syntax>>> vars)
     if (retries == 10)
         return nullptr;
 
-    return vars[r][std::rand() % vars[r].size()];
+    return vars[r][random(vars[r].size())];
+}
+
+bool
+Generator::prepareExpressions()
+{
+    if (!_options.usesExpressionLibrary() || _expressions != nullptr)
+        return true;
+
+    return loadExpressions(_options, _expressions);
+}
+
+bool
+Generator::loadExpressions(const Options                            &options,
+                           std::shared_ptr<const ExpressionLibrary> &library)
+{
+    size_t count = (options.expressions != 0) ? options.expressions : 1024;
+
+    library = nullptr;
+    if (!options.usesExpressionLibrary())
+        return true;
+
+    auto prepared = std::make_shared<ExpressionLibrary>();
+
+    if (!options.expressionFile.empty() &&
+        access(options.expressionFile.c_str(), F_OK) == 0)
+    {
+        if (!prepared->load(options.expressionFile))
+            return false;
+    }
+    else
+    {
+        /* Templates don't consume decisions of the random source */
+        prepared->build(count, options.literalPercent);
+        if (!options.expressionFile.empty())
+            prepared->save(options.expressionFile);
+    }
+
+    library = prepared;
+    return true;
 }
 
 std::shared_ptr<Syntax>
-Generator::getExpressionEvaluatingToValue(std::string value)
+Generator::getExpressionEvaluatingToValue(const std::string &value)
 {
     int  r;
-    auto lit = Syntax::create(SyntaxKind::Literal, value);
 
     assert(value != "");
-    r = std::rand() % 10;
+    if (_expressions != nullptr)
+    {
+        size_t index = random(_expressions->size(ExpressionClass::Value));
+
+        return _expressions->instantiate(ExpressionClass::Value, index,
+                                         stoull(value, NULL, 0));
+    }
+
+    auto lit = Syntax::create(SyntaxKind::Literal, value);
+    if (_options.literalPercent < 0)
+        r = random(10);
+    else
+        r = (static_cast<int>(random(100)) < _options.literalPercent)
+            ? 0
+            : 6 + random(4);
 
     if (r <= 5)
     {
@@ -88,7 +137,7 @@ Generator::getExpressionEvaluatingToValue(std::string value)
     {
         /* Trivial minus */
         uint32_t val = stoull(value, NULL, 0);
-        uint32_t r = rand();
+        uint32_t r = random();
         uint32_t target = r + val;
 
         return Syntax::create(
@@ -100,7 +149,7 @@ Generator::getExpressionEvaluatingToValue(std::string value)
     {
         /* Trivial plus */
         uint32_t val = stoull(value, NULL, 0);
-        uint32_t r = rand();
+        uint32_t r = random();
         uint32_t target = r - val;
 
         return Syntax::create(
@@ -133,14 +182,23 @@ Generator::getAlwaysExpression(bool truth)
 {
     int r;
 
-    r = std::rand() % 2;
+    if (_expressions != nullptr)
+    {
+        ExpressionClass kind = truth ? ExpressionClass::True
+                                     : ExpressionClass::False;
+        size_t          index = random(_expressions->size(kind));
+
+        return _expressions->instantiate(kind, index, random());
+    }
+
+    r = random(2);
 
     if (r == 0)
     {
         /* Trivial */
         std::string ops[] = { "==", ">=", "<=" };
         std::string negops[] = { "!=", "<", ">" };
-        int         r2 = std::rand() % (sizeof(ops) / sizeof(*ops));
+        int         r2 = random(sizeof(ops) / sizeof(*ops));
 
         auto lit = getExpressionEvaluatingToValue(generateValue("uint32_t"));
         return Syntax::create(SyntaxKind::Binary, truth ? ops[r2] : negops[r2],
@@ -168,28 +226,87 @@ std::shared_ptr<Syntax>
 Generator::createRandomObfuscatedBlock(
     std::vector<std::vector<std::shared_ptr<Syntax>>> &falseVars)
 {
-    auto falseVar = Syntax::create(SyntaxKind::Identifier, generateString(3));
+    auto falseVar = Syntax::create(SyntaxKind::Identifier, generateName());
     auto falseVarDecl =
         Syntax::create(SyntaxKind::Declaration,
                        Syntax::create(SyntaxKind::Type, "uint32_t"), falseVar);
     auto block = Syntax::create(SyntaxKind::Block, falseVarDecl);
 
+    /* Shape options only apply to the outermost obfuscation of the goal */
+    _nesting++;
     block->add(obfuscate(Syntax::create(SyntaxKind::Assign, falseVar,
                                         Syntax::create(SyntaxKind::Literal,
                                                        generateValue("uint32_t"))),
                          falseVars));
+    _nesting--;
     return block;
 }
 
+int
+Generator::nextObfuscationStep(bool shaped, int &steps)
+{
+    int r;
+
+    if (!shaped || _options.obfuscationDepth < 0)
+    {
+        r = random(7);
+        if (r >= 1 && shaped && _options.obfuscationBranch > 0)
+            r = _options.obfuscationBranch;
+        else if (r >= 1 && shaped && _options.hasBranchWeights())
+            r = pickWeightedBranch();
+        return r;
+    }
+
+    if (steps++ == _options.obfuscationDepth)
+        return 0;
+
+    if (_options.obfuscationBranch > 0)
+        return _options.obfuscationBranch;
+    return pickWeightedBranch();
+}
+
+int
+Generator::pickWeightedBranch()
+{
+    unsigned total = 0;
+    unsigned r;
+
+    for (auto weight : _options.branchWeights)
+        total += weight;
+
+    if (total == 0)
+        return random(6) + 1;
+
+    r = random(total);
+    for (size_t i = 0; i < _options.branchWeights.size(); ++i)
+    {
+        if (r < _options.branchWeights[i])
+            return i + 1;
+        r -= _options.branchWeights[i];
+    }
+    return _options.branchWeights.size();
+}
+
+bool
+Generator::nextBranch(bool shaped, int limit, int &count)
+{
+    if (shaped && limit >= 0)
+        return count++ < limit;
+    return random(10) >= 3;
+}
+
 std::shared_ptr<Syntax>
 Generator::obfuscate(
     std::shared_ptr<Syntax>                            resultExpr,
     std::vector<std::vector<std::shared_ptr<Syntax>>> &falseVars)
 {
     int                     r;
+    int                     steps = 0;
+    bool                    shaped = (_nesting == 0);
     std::shared_ptr<Syntax> tmpExpr = resultExpr;
+    PerfScope               scope(_perf, PerfStage::Obfuscate);
 
-    while ((r = std::rand() % 7) >= 1)
+    while ((r = nextObfuscationStep(shaped, steps)) >= 1)
     {
         if (r == 1)
         {
@@ -218,18 +335,18 @@ Generator::obfuscate(
             auto falseVar = Syntax::create(
                 SyntaxKind::Declaration,
                 Syntax::create(SyntaxKind::Type, "uint32_t"),
-                Syntax::create(SyntaxKind::Identifier, generateString(3)));
+                Syntax::create(SyntaxKind::Identifier, generateName()));
             tmpExpr->add(falseVar);
         }
         else if (r == 3)
         {
-            int r2;
+            int branches = 0;
             /* If */
             tmpExpr = Syntax::create(SyntaxKind::IfGroup,
                                      Syntax::create(SyntaxKind::If,
                                                     getAlwaysExpression(true),
                                                     tmpExpr));
-            while ((r2 = std::rand() % 10) >= 3)
+            while (nextBranch(shaped, _options.ifGroupLength, branches))
             {
                 std::shared_ptr<Syntax> elseGoal;
 
@@ -240,6 +357,16 @@ Generator::obfuscate(
                                        Syntax::create(SyntaxKind::Literal,
                                                       generateValue("uint32_t")));
                 }
+                else if (shaped && _options.ifGroupLength >= 0 &&
+                         resultExpr->getKind() == SyntaxKind::Assign)
+                {
+                    /* Requested length is honoured for assignments too */
+                    elseGoal =
+                        Syntax::create(SyntaxKind::Assign,
+                                       resultExpr->children()[0],
+                                       Syntax::create(SyntaxKind::Literal,
+                                                      generateValue("uint32_t")));
+                }
 
                 if (elseGoal != nullptr)
                 {
@@ -260,7 +387,7 @@ Generator::obfuscate(
             if (randVar == nullptr)
             {
                 randVar =
-                    Syntax::create(SyntaxKind::Identifier, generateString(3));
+                    Syntax::create(SyntaxKind::Identifier, generateName());
                 assuredValue =
                     Syntax::create(SyntaxKind::Literal, generateValue("uint32_t"));
                 auto randVarDecl =
@@ -283,8 +410,8 @@ Generator::obfuscate(
 
             if (assuredValue != nullptr)
             {
-                int r2;
-                while ((r2 = std::rand() % 10) >= 3)
+                int cases = 0;
+                while (nextBranch(shaped, _options.switchCases, cases))
                 {
                     auto tmpValue = generateValue("uint32_t");
                     if (tmpValue != assuredValue->getStringValue())
@@ -292,7 +419,7 @@ Generator::obfuscate(
                         auto secCase = Syntax::create(
                             SyntaxKind::Case,
                             Syntax::create(SyntaxKind::Literal, tmpValue));
-                        if ((std::rand() % 10) >= 2)
+                        if (random(10) >= 2)
                         {
                             if (resultExpr->getKind() == SyntaxKind::Return)
                             {
@@ -312,7 +439,7 @@ Generator::obfuscate(
                                                    generateValue("uint32_t")));
                                 secCase->add(elseGoal);
                             }
-                            if (std::rand() % 2 == 1)
+                            if (random(2) == 1)
                             {
                                 secCase->add(Syntax::create(SyntaxKind::Break));
                             }
@@ -324,7 +451,7 @@ Generator::obfuscate(
                         {
                             secCase->add(
                                 createRandomObfuscatedBlock(falseVars));
-                            if (std::rand() % 2 == 1)
+                            if (random(2) == 1)
                             {
                                 secCase->children()[1]->add(
                                     Syntax::create(SyntaxKind::Break));
@@ -346,12 +473,12 @@ Generator::obfuscate(
         {
             /* For has constant expression - that's not entirely great */
             int r2;
-            auto id = Syntax::create(SyntaxKind::Identifier, generateString(3));
+            auto id = Syntax::create(SyntaxKind::Identifier, generateName());
             auto falseVar = Syntax::create(
                 SyntaxKind::Declaration,
                 Syntax::create(SyntaxKind::Type, "uint32_t"),
                 id);
-            int  minorVar = (rand() % 9) + 1;
+            int  minorVar = random(9) + 1;
             auto oldGoalExpr = tmpExpr;
 
             tmpExpr = Syntax::create(SyntaxKind::For,
@@ -370,13 +497,13 @@ Generator::obfuscate(
         {
             /* While has constant expressions - that's not entirely great */
             int r2;
-            auto id = Syntax::create(SyntaxKind::Identifier, generateString(3));
+            auto id = Syntax::create(SyntaxKind::Identifier, generateName());
             auto falseVar = Syntax::create(
                 SyntaxKind::Declaration,
                 Syntax::create(SyntaxKind::Type, "uint32_t"),
                 id,
                 Syntax::create(SyntaxKind::Literal, "0"));
-            int  minorVar = (rand() % 9) + 1;
+            int  minorVar = random(9) + 1;
             auto oldGoalExpr = tmpExpr;
             auto outerBlock = Syntax::create(SyntaxKind::Block);
             auto innerBlock = Syntax::create(SyntaxKind::Block);
@@ -400,175 +527,959 @@ Generator::obfuscate(
     return tmpExpr;
 }
 
+/**
+ * @brief      Report every variant of the stream to the callback
+ *
+ * @param      stream    The stream
+ * @param      callback  The callback, returns @c true to stop
+ *
+ * @return     @c -1 if stopped, otherwise the number of variants
+ */
+static int
+drain(VariantStream &stream, const std::function<bool()> &callback)
+{
+    while (stream.next())
+    {
+        if (callback())
+            return -1;
+    }
+    return stream.stopped() ? -1 : static_cast<int>(stream.count());
+}
+
 int
 Generator::permute(std::vector<std::shared_ptr<Syntax>> &children,
                    int                                   start,
                    int                                   end,
                    int                                   shift,
-                   std::function<bool()>                 callback)
+                   const std::function<bool()>          &callback)
 {
-    std::map<std::shared_ptr<Syntax>, int> map;
-    int                                    count = 0;
-    int                                    sum = 0;
-    int                                    r;
+    VariantStream stream(*this, children, start, end, shift);
 
-    if (end - start == 0)
+    return drain(stream, callback);
+}
+
+int
+Generator::getPermutationStart(SyntaxKind kind)
+{
+    switch (kind)
     {
-        return -1;
+        case SyntaxKind::IfGroup:
+            return 0;
+        case SyntaxKind::Switch:
+        case SyntaxKind::While:
+            return 1;
+        case SyntaxKind::For:
+            return 3;
+        default:
+            return -1;
     }
+}
+
+int
+Generator::permute(const std::shared_ptr<Syntax> &root,
+                   int                            shift,
+                   const std::function<bool()>   &callback)
+{
+    VariantStream stream(*this, root, shift);
+
+    return drain(stream, callback);
+}
+
+std::shared_ptr<Syntax>
+Generator::generateProgram()
+{
+    if (!prepareExpressions())
+        return nullptr;
+
+    std::shared_ptr<Syntax> root = Syntax::create(SyntaxKind::Root);
+    root->add(Syntax::create(SyntaxKind::Exact,
+        "#include <assert.h>\n#include <stdint.h>\n"));
+
+    _names.reset((static_cast<uint64_t>(random()) << 32) | random());
+
+    size_t goals = std::max<size_t>(_options.goals, 1);
+    size_t functions = std::min(std::max<size_t>(_options.goalFunctions, 1),
+                                goals);
+
+    if (functions > 1)
+        return generateGoalFunctions(root, goals, functions);
+
+    auto goal = Syntax::create(SyntaxKind::Literal, generateValue("uint32_t"));
+    auto block = Syntax::create(SyntaxKind::Block);
+    root->add(Syntax::create(
+        SyntaxKind::Function,
+        Syntax::create(SyntaxKind::FunctionProto,
+                       Syntax::create(SyntaxKind::Type, "uint32_t"),
+                       Syntax::create(SyntaxKind::Identifier, "main")),
+        block));
+
+    addObfuscatedGoal(block, goal);
+    addGoals(block, goals - 1);
 
-    for (auto &ch : children)
+    block->add(Syntax::create(SyntaxKind::Return,
+                              Syntax::create(SyntaxKind::Literal, "0")));
+    return root;
+}
+
+void
+Generator::addGoals(std::shared_ptr<Syntax> block, size_t count)
+{
+    /* Every goal has its own variables, so the goals are independent */
+    for (size_t g = 0; g < count; ++g)
     {
-        /* This weird condition accelerates changes */
-        map[ch] = ((std::rand() % 50) < 30)
-            ? count
-            : count++;
+        addObfuscatedGoal(block, Syntax::create(SyntaxKind::Literal,
+                                                generateValue("uint32_t")));
     }
+}
 
-    while (std::next_permutation(
-        children.begin() + start, children.begin() + end,
-        [&map](std::shared_ptr<Syntax> a, std::shared_ptr<Syntax> b) {
-            return map[a] < map[b];
-        }))
+std::shared_ptr<Syntax>
+Generator::generateGoalFunctions(std::shared_ptr<Syntax> root,
+                                 size_t                  goals,
+                                 size_t                  functions)
+{
+    auto block = Syntax::create(SyntaxKind::Block);
+
+    for (size_t f = 0; f < functions; ++f)
     {
-        if (callback())
-            return -1;
-        for (int i = start; i < end; ++i)
+        auto        body = Syntax::create(SyntaxKind::Block);
+        std::string name = "goal_" + std::to_string(f);
+
+        addGoals(body, (f + 1) * goals / functions - f * goals / functions);
+        body->add(Syntax::create(SyntaxKind::Return,
+                                 Syntax::create(SyntaxKind::Literal, "0")));
+        root->add(Syntax::create(
+            SyntaxKind::Function,
+            Syntax::create(SyntaxKind::FunctionProto,
+                           Syntax::create(SyntaxKind::Type, "uint32_t"),
+                           Syntax::create(SyntaxKind::Identifier, name)),
+            body));
+        block->add(Syntax::create(SyntaxKind::Call, name));
+    }
+
+    block->add(Syntax::create(SyntaxKind::Return,
+                              Syntax::create(SyntaxKind::Literal, "0")));
+    root->add(Syntax::create(
+        SyntaxKind::Function,
+        Syntax::create(SyntaxKind::FunctionProto,
+                       Syntax::create(SyntaxKind::Type, "uint32_t"),
+                       Syntax::create(SyntaxKind::Identifier, "main")),
+        block));
+    return root;
+}
+
+std::shared_ptr<Syntax>
+Generator::addObfuscatedGoal(std::shared_ptr<Syntax> block,
+                             std::shared_ptr<Syntax> goal)
+{
+    std::vector<std::vector<std::shared_ptr<Syntax>>> vars;
+    auto falseVar = Syntax::create(SyntaxKind::Identifier, generateName());
+    auto falseVarDecl =
+        Syntax::create(SyntaxKind::Declaration,
+                       Syntax::create(SyntaxKind::Type, "uint32_t"), falseVar);
+    block->add(falseVarDecl);
+    auto goalExpr = Syntax::create(SyntaxKind::Assign, falseVar, goal);
+    auto goalCheckExpr = Syntax::create(
+        SyntaxKind::Assert,
+        Syntax::create(SyntaxKind::Binary, "==", falseVar, goal));
+    block->add(obfuscate(goalExpr, vars));
+    block->add(goalCheckExpr);
+    return falseVar;
+}
+
+std::shared_ptr<Syntax>
+Generator::generateLargeProgram(size_t targetBytes, size_t targetNodes)
+{
+    if (!prepareExpressions())
+        return nullptr;
+
+    std::shared_ptr<Syntax> root = Syntax::create(SyntaxKind::Root);
+    root->add(Syntax::create(SyntaxKind::Exact,
+        "#include <assert.h>\n#include <stdint.h>\n"));
+
+    _names.reset((static_cast<uint64_t>(random()) << 32) | random());
+
+    std::vector<std::shared_ptr<Syntax>> goals;
+    std::vector<bool>                    called;
+    std::string                          scratch;
+    size_t                               bytes = root->toString().size();
+    size_t                               nodes = root->countNodes();
+
+    auto reached = [&]() {
+        return (targetBytes != 0 && bytes >= targetBytes) ||
+               (targetNodes != 0 && nodes >= targetNodes);
+    };
+
+    /*
+     * Functions may only call the ones generated before them, so the call
+     * graph is acyclic and every function is visited exactly once.
+     */
+    for (size_t f = 0; !reached(); ++f)
+    {
+        auto goal =
+            Syntax::create(SyntaxKind::Literal, generateValue("uint32_t"));
+        auto block = Syntax::create(SyntaxKind::Block);
+        auto var = addObfuscatedGoal(block, goal);
+        int  calls;
+
+        addGoals(block, std::max<size_t>(_options.goals, 1) - 1);
+        calls = (f == 0) ? 0 : random(4);
+
+        for (int c = 0; c < calls; ++c)
         {
-            r = permute(children[i], shift + 1, callback);
-            if (r == -1)
-                return -1;
-            sum += r;
+            size_t callee = random(f);
+            auto   tmp =
+                Syntax::create(SyntaxKind::Identifier, generateName());
+
+            /* The callee returns its goal, so the result is checked too */
+            block->add(Syntax::create(
+                SyntaxKind::Block,
+                Syntax::create(SyntaxKind::Declaration,
+                               Syntax::create(SyntaxKind::Type, "uint32_t"),
+                               tmp,
+                               Syntax::create(SyntaxKind::Call,
+                                              "fn_" + std::to_string(callee))),
+                Syntax::create(
+                    SyntaxKind::Assert,
+                    Syntax::create(SyntaxKind::Binary, "==", tmp,
+                                   goals[callee]))));
+            called[callee] = true;
         }
+        block->add(Syntax::create(SyntaxKind::Return, var));
 
-        sum++;
+        auto function = Syntax::create(
+            SyntaxKind::Function,
+            Syntax::create(SyntaxKind::FunctionProto,
+                           Syntax::create(SyntaxKind::Type, "uint32_t"),
+                           Syntax::create(SyntaxKind::Identifier,
+                                          "fn_" + std::to_string(f))),
+            block);
+        root->add(function);
+        goals.push_back(goal);
+        called.push_back(false);
+
+        scratch.clear();
+        function->render(scratch);
+        bytes += scratch.size();
+        nodes += function->countNodes();
     }
 
-    return sum;
+    /* Entry point reaches every function which is not called otherwise */
+    auto block = Syntax::create(SyntaxKind::Block);
+    for (size_t f = 0; f < called.size(); ++f)
+    {
+        if (!called[f])
+        {
+            block->add(Syntax::create(SyntaxKind::Call,
+                                      "fn_" + std::to_string(f)));
+        }
+    }
+    block->add(Syntax::create(SyntaxKind::Return,
+                              Syntax::create(SyntaxKind::Literal, "0")));
+    root->add(Syntax::create(
+        SyntaxKind::Function,
+        Syntax::create(SyntaxKind::FunctionProto,
+                       Syntax::create(SyntaxKind::Type, "uint32_t"),
+                       Syntax::create(SyntaxKind::Identifier, "main")),
+        block));
+    return root;
 }
 
-int
-Generator::permute(std::shared_ptr<Syntax> root,
-                   int                     shift,
-                   std::function<bool()>   callback)
+/**
+ * @brief      Write the data to the file without any heap allocation
+ *
+ * @param      name  The file name
+ * @param      data  The data
+ */
+static void
+writeFile(const std::string &name, const std::string &data)
 {
-    int sum = 0, r;
-    if (root->children().size() == 0)
-        return 0;
+    const char *pos = data.data();
+    size_t      left = data.size();
+    int         fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+        return;
 
-    switch (root->getKind())
+    while (left > 0)
     {
-        case SyntaxKind::IfGroup:
-        case SyntaxKind::Switch:
-        {
-            r = permute(root->children(),
-                        root->getKind() == SyntaxKind::IfGroup ? 0 : 1,
-                        root->children().size(), shift + 1, callback);
-            if (r == -1)
-                return -1;
-            sum += r;
+        ssize_t written = write(fd, pos, left);
+
+        if (written <= 0)
             break;
+        pos += written;
+        left -= written;
+    }
+    close(fd);
+}
+
+/**
+ * @brief      Render the program and write it to the file
+ *
+ * @param      root      The root of the program
+ * @param      renderer  The parallel renderer, @c nullptr to render here
+ * @param      name      The file name
+ * @param      buffer    The buffer reused for rendering
+ * @param      perf      The performance counters, @c nullptr if disabled
+ */
+static void
+writeProgram(const std::shared_ptr<Syntax> &root,
+             ParallelRenderer              *renderer,
+             const std::string             &name,
+             std::string                   &buffer,
+             PerfCounters                  *perf)
+{
+    if (renderer != nullptr)
+    {
+        /* Rendering writes straight into the mapped file */
+        PerfScope scope(perf, PerfStage::Render);
+
+        renderer->renderToFile(name);
+        return;
+    }
+
+    {
+        PerfScope scope(perf, PerfStage::Render);
+
+        buffer.clear();
+        root->render(buffer);
+    }
+
+    PerfScope scope(perf, PerfStage::Write);
+
+    writeFile(name, buffer);
+}
+
+/**
+ * @brief      Collect the asserts of the subtree in the order they are
+ *             rendered
+ *
+ * @param      node     The node
+ * @param      asserts  The asserts
+ */
+static void
+collectAsserts(const std::shared_ptr<Syntax> &node,
+               std::vector<Syntax *>         &asserts)
+{
+    if (node == nullptr)
+        return;
+
+    if (node->getKind() == SyntaxKind::Assert)
+        asserts.push_back(node.get());
+
+    for (auto &ch : node->children())
+    {
+        collectAsserts(ch, asserts);
+    }
+}
+
+/**
+ * @brief      List the asserts of the program with the function they are
+ *             in and the truth the generator expects of them
+ *
+ * @param      root  The root of the program
+ * @param      file  The CSV file
+ *
+ * @return     @c true on success
+ */
+static bool
+writeAsserts(const std::shared_ptr<Syntax> &root, const std::string &file)
+{
+    std::ofstream ofs(file);
+    size_t        index = 0;
+
+    if (!ofs.is_open())
+        return false;
+
+    ofs << "assert,function,condition,expected" << std::endl;
+    for (auto &function : root->children())
+    {
+        std::vector<Syntax *> asserts;
+
+        if (function->getKind() != SyntaxKind::Function)
+            continue;
+
+        collectAsserts(function, asserts);
+
+        /* Every goal is checked against the value it was built to hold */
+        for (auto assert : asserts)
+        {
+            ofs << index++ << ","
+                << function->children()[0]->children()[1]->getStringValue()
+                << ",\"" << assert->children()[0]->toString() << "\",true"
+                << std::endl;
         }
-        case SyntaxKind::For:
+    }
+    return ofs.good();
+}
+
+/**
+ * @brief      Encode everything the output of a run depends on
+ *
+ * @param      options  The options
+ * @param      out      The output
+ */
+static void
+putFingerprint(const Options &options, std::string &out)
+{
+    putVarint(out, options.variantLimit);
+    putVarint(out, options.shardIndex);
+    putVarint(out, options.shardCount);
+    putVarint(out, options.corpus ? 1 : 0);
+    putVarint(out, options.targetBytes);
+    putVarint(out, options.targetNodes);
+    putVarint(out, options.obfuscationDepth + 1);
+    putVarint(out, options.obfuscationBranch + 1);
+    putVarint(out, options.switchCases + 1);
+    putVarint(out, options.ifGroupLength + 1);
+    for (auto weight : options.branchWeights)
+        putVarint(out, weight);
+    putVarint(out, options.literalPercent + 1);
+    putVarint(out, options.programs);
+    if (options.goals != 0)
+    {
+        putVarint(out, options.goals);
+        putVarint(out, options.goalFunctions);
+    }
+    if (!options.astFile.empty())
+    {
+        putVarint(out, options.astFile.size());
+        out.append(options.astFile);
+    }
+    if (options.variantOrder != VariantOrder::Lexicographic)
+        putVarint(out, static_cast<uint64_t>(options.variantOrder) + 1);
+    if (options.usesExpressionLibrary())
+    {
+        putVarint(out, options.expressions);
+        putVarint(out, options.expressionFile.size());
+        out.append(options.expressionFile);
+    }
+}
+
+bool
+Generator::generateTestScript(const std::string &path)
+{
+    Checkpoint  checkpoint;
+    std::string fingerprint;
+    bool        checkpointed = !_options.checkpointFile.empty();
+    bool        resume = false;
+
+    _checkpointFailed = false;
+
+    /* Minimized variants are chosen only once all of them are known */
+    if (_options.minimizeStrength != 0 && _options.variantLimit == 0)
+    {
+        std::cerr << "Minimizing needs a limit of variants" << std::endl;
+        return false;
+    }
+    if (_options.minimizeStrength != 0 && checkpointed)
+    {
+        std::cerr << "Minimized runs can't be checkpointed" << std::endl;
+        checkpointed = false;
+    }
+
+    putFingerprint(_options, fingerprint);
+    if (checkpointed && !_random->saveState(fingerprint))
+    {
+        std::cerr << "The random source can't be checkpointed" << std::endl;
+        checkpointed = false;
+    }
+
+    if (checkpointed && checkpoint.load(_options.checkpointFile))
+    {
+        resume = checkpoint.fingerprint == fingerprint;
+        if (!resume)
         {
-            r = permute(root->children(),
-                        3,
-                        root->children().size(), shift + 1, callback);
-            if (r == -1)
-                return -1;
-            sum += r;
-            break;
+            std::cerr << "Ignoring checkpoint of a different run "
+                      << _options.checkpointFile << std::endl;
+            checkpoint = Checkpoint();
         }
-        case SyntaxKind::While:
+    }
+    checkpoint.fingerprint = fingerprint;
+
+    std::unique_ptr<PerfCounters> counters;
+    AstFile                       ast;
+
+    if (!_options.astFile.empty())
+    {
+        if (!ast.open(_options.astFile) || ast.root() == AstFile::none)
         {
-            r = permute(root->children(),
-                        1,
-                        root->children().size(), shift + 1, callback);
-            if (r == -1)
-                return -1;
-            sum += r;
-            break;
+            std::cerr << "Failed to load AST " << _options.astFile
+                      << std::endl;
+            return false;
         }
-        case SyntaxKind::Type:
-        case SyntaxKind::Identifier:
-        case SyntaxKind::Literal:
-        case SyntaxKind::Exact:
-        case SyntaxKind::Declaration:
-        case SyntaxKind::FunctionProto:
-        case SyntaxKind::Return:
-        case SyntaxKind::Assign:
-        case SyntaxKind::Binary:
-        case SyntaxKind::Break:
-        case SyntaxKind::Assert:
-        case SyntaxKind::Nop:
+        _ast = &ast;
+    }
+
+    if (!prepareExpressions())
+    {
+        std::cerr << "Failed to load expressions " << _options.expressionFile
+                  << std::endl;
+        _ast = nullptr;
+        return false;
+    }
+
+    if (_options.perfCounters)
+    {
+        counters.reset(new PerfCounters());
+        _perf = counters.get();
+    }
+
+    for (; checkpoint.program < _options.programs; ++checkpoint.program)
+    {
+        std::string programPath = path;
+
+        if (_options.programs > 1)
         {
-            break;
+            programPath.append("/").append(
+                std::to_string(checkpoint.program));
+            mkdir(programPath.c_str(), 0755);
         }
-        default:
+
+        if (!emitProgram(programPath, checkpointed ? &checkpoint : nullptr,
+                         resume))
         {
-            for (auto &ch : root->children())
-            {
-                r = permute(ch, shift + 1, callback);
-                if (r == -1)
-                    return -1;
-                sum += r;
-            }
+            std::cerr << "Failed to resume checkpoint "
+                      << _options.checkpointFile << std::endl;
+            _perf = nullptr;
+            _ast = nullptr;
+            return false;
         }
+        resume = false;
+    }
+
+    if (counters != nullptr)
+    {
+        counters->report(std::cout);
+        _perf = nullptr;
     }
-    return sum;
+    _ast = nullptr;
+
+    /* A finished run does nothing when started again */
+    if (checkpointed)
+    {
+        checkpoint.variant = 0;
+        checkpoint.outputSize = 0;
+        checkpoint.swapsSize = 0;
+        checkpoint.startRandom.clear();
+        checkpoint.random.clear();
+        checkpoint.ordering.clear();
+        checkpoint.stream.clear();
+        saveCheckpoint(checkpoint);
+    }
+    return true;
 }
 
 void
-Generator::generateTestScript(std::string path)
+Generator::forEachVariant(const std::shared_ptr<Syntax>     &root,
+                          const std::function<void(size_t)> &callback)
 {
-    std::ostream &os = std::cout;
+    VariantStream stream(*this, root, _options.variantOrder);
+    size_t        i = 0;
 
-    std::shared_ptr<Syntax> root = Syntax::create(SyntaxKind::Root);
-    root->add(Syntax::create(SyntaxKind::Exact,
-        "#include <assert.h>\n#include <stdint.h>\n"));
+    if (_options.minimizeStrength == 0)
+    {
+        while (stream.next())
+        {
+            if (_options.ownsVariant(i))
+                callback(i);
+            if (++i == _options.variantLimit)
+                break;
+        }
+        return;
+    }
 
-    auto goal = Syntax::create(SyntaxKind::Literal, generateValue("uint32_t"));
-    auto block = Syntax::create(SyntaxKind::Block);
-    root->add(Syntax::create(
-        SyntaxKind::Function,
-        Syntax::create(SyntaxKind::FunctionProto,
-                       Syntax::create(SyntaxKind::Type, "uint32_t"),
-                       Syntax::create(SyntaxKind::Identifier, "main")),
-        block));
+    /* Variants are kept as deltas until the minimizer chooses them */
+    Corpus              corpus(root);
+    Minimizer           minimizer(_options.minimizeStrength);
+    std::string         deltas;
+    std::vector<size_t> offsets;
 
+    while (stream.next())
     {
-        std::vector<std::vector<std::shared_ptr<Syntax>>> vars;
-        auto                                              falseVar =
-            Syntax::create(SyntaxKind::Identifier, generateString(3));
-        auto falseVarDecl =
-            Syntax::create(SyntaxKind::Declaration,
-                           Syntax::create(SyntaxKind::Type, "uint32_t"),
-                           falseVar);
-        block->add(falseVarDecl);
-        auto goalExpr = Syntax::create(SyntaxKind::Assign, falseVar, goal);
-        auto goalCheckExpr = Syntax::create(
-            SyntaxKind::Assert,
-            Syntax::create(SyntaxKind::Binary, "==", falseVar, goal));
-        block->add(obfuscate(goalExpr, vars));
-        block->add(goalCheckExpr);
+        offsets.push_back(deltas.size());
+        corpus.encodeVariant(i, deltas);
+        minimizer.add(corpus);
+        if (++i == _options.variantLimit)
+            break;
     }
+    offsets.push_back(deltas.size());
 
-    block->add(Syntax::create(SyntaxKind::Return,
-                              Syntax::create(SyntaxKind::Literal, "0")));
+    for (auto v : minimizer.select())
+    {
+        const char *pos = deltas.data() + offsets[v];
+        size_t      index;
+
+        if (_options.ownsVariant(v) &&
+            corpus.decodeVariant(pos, deltas.data() + offsets[v + 1], index))
+            callback(index);
+    }
+    corpus.restorePrimary();
+}
+
+void
+Generator::saveCheckpoint(const Checkpoint &checkpoint)
+{
+    if (checkpoint.save(_options.checkpointFile) || _checkpointFailed)
+        return;
+
+    std::cerr << "Failed to save checkpoint " << _options.checkpointFile
+              << ", the run can't be resumed" << std::endl;
+    _checkpointFailed = true;
+}
+
+bool
+Generator::emitProgram(const std::string &path,
+                       Checkpoint        *checkpoint,
+                       bool               resume)
+{
+    size_t allocations = getAllocationCount();
+    size_t programAllocations;
+    size_t warmupAllocations = 0;
+    size_t steadyAllocations = 0;
+    size_t maxAllocations = 0;
+    size_t minimizerAllocations = 0;
+    bool   started = resume && !checkpoint->random.empty();
+
+    if (resume)
+    {
+        const char *pos = checkpoint->startRandom.data();
+        const char *end = pos + checkpoint->startRandom.size();
+
+        if (!_random->restoreState(pos, end))
+            return false;
+    }
+    else if (checkpoint != nullptr)
+    {
+        checkpoint->startRandom.clear();
+        _random->saveState(checkpoint->startRandom);
+        checkpoint->variant = 0;
+        checkpoint->outputSize = 0;
+        checkpoint->swapsSize = 0;
+        checkpoint->random.clear();
+        checkpoint->ordering.clear();
+        checkpoint->stream.clear();
+        saveCheckpoint(*checkpoint);
+    }
+
+    /* The same random state always produces the same tree */
+    std::shared_ptr<Syntax> root;
+    {
+        PerfScope scope(_perf, PerfStage::Build);
+
+        if (_ast != nullptr)
+            root = _ast->load();
+        else if (_options.isLargeProgram())
+            root = generateLargeProgram(_options.targetBytes,
+                                        _options.targetNodes);
+        else
+            root = generateProgram();
+    }
 
-    std::ofstream prim(path + "/_primary.c");
-    prim << root->toString();
-    prim.close();
+    if (root == nullptr)
+        return false;
 
-    int i = 0;
+    /* Variants are ordered as in the run that saved the tree */
+    if (_ast != nullptr && !started)
+    {
+        size_t      length;
+        const char *pos = _ast->randomState(length);
+
+        if (pos != nullptr && !_random->restoreState(pos, pos + length))
+            std::cerr << "Ignoring random state of " << _options.astFile
+                      << std::endl;
+    }
+
+    if (_options.saveAst && !started && _options.shardIndex == 0)
+    {
+        std::string state;
+
+        /* A source that can't be saved leaves the order to --seed */
+        if (!_random->saveState(state))
+            state.clear();
+        if (!AstFile::save(root, path + "/_primary.ast", state))
+            std::cerr << "Failed to save AST " << path << "/_primary.ast"
+                      << std::endl;
+    }
+
+    /* Asserts keep their place in every variant, so one list is enough */
+    if (_options.goals != 0 && !started && _options.shardIndex == 0 &&
+        !writeAsserts(root, path + "/asserts.csv"))
+        std::cerr << "Failed to write " << path << "/asserts.csv"
+                  << std::endl;
+
+    programAllocations = getAllocationCount() - allocations;
+
+    /* Node indices and primary orderings must be taken before permuting */
+    std::vector<Syntax *>          nodes;
+    std::unique_ptr<Corpus>        corpus;
+    std::unique_ptr<VariantStream> stream;
+    std::unique_ptr<Minimizer>     minimizer;
+
+    if (checkpoint != nullptr)
+        VariantStream::collectNodes(root, nodes);
+    if (_options.minimizeStrength != 0)
+        minimizer.reset(new Minimizer(_options.minimizeStrength));
+    if (_options.corpus || checkpoint != nullptr || minimizer != nullptr)
+        corpus.reset(new Corpus(root));
+
+    size_t i = 0;
+
+    if (started)
+    {
+        const char *pos = checkpoint->ordering.data();
+        const char *end = pos + checkpoint->ordering.size();
+
+        stream.reset(new VariantStream(*this));
+        if (!corpus->decodeVariant(pos, end, i))
+            return false;
+
+        pos = checkpoint->stream.data();
+        end = pos + checkpoint->stream.size();
+        if (!stream->restoreState(pos, end, nodes))
+            return false;
+
+        pos = checkpoint->random.data();
+        end = pos + checkpoint->random.size();
+        if (!_random->restoreState(pos, end))
+            return false;
+        i = checkpoint->variant;
+    }
+    else
+    {
+        stream.reset(new VariantStream(*this, root, _options.variantOrder));
+    }
+
+    /* Buffers are reused for every variant once they are large enough */
+    std::string   buffer;
+    std::string   name;
+    std::ofstream ofs;
+    uint64_t      outputSize = started ? checkpoint->outputSize : 0;
+
+    std::unique_ptr<ParallelRenderer> renderer;
+
+    /* Variants kept as corpus entries until the minimizer chooses them */
+    std::string         deltas;
+    std::vector<size_t> offsets;
+
+    name.reserve(path.size() + 32);
+    if (_options.corpus)
+    {
+        name.assign(path).append("/corpus.fzc");
+        if (_options.shardCount > 1)
+        {
+            name.assign(path).append("/corpus.")
+                .append(std::to_string(_options.shardIndex)).append(".fzc");
+        }
+
+        if (started)
+        {
+            /* Whatever was written after the checkpoint is written again */
+            if (truncate(name.c_str(), outputSize) != 0)
+                return false;
+            ofs.open(name, std::ios::binary | std::ios::app);
+        }
+        else
+        {
+            ofs.open(name, std::ios::binary);
+            corpus->encodePrimary(buffer);
+            ofs.write(buffer.data(), buffer.size());
+            outputSize += buffer.size();
+        }
+    }
+    else
+    {
+        /* Large programs are rendered by several threads into the files */
+        if (_options.isLargeProgram())
+            renderer.reset(
+                new ParallelRenderer(root, _options.renderThreads, _perf));
+
+        /* Every shard builds the same tree, so only the first one saves it */
+        if (!started && _options.shardIndex == 0)
+        {
+            name.assign(path).append("/_primary.c");
+            writeProgram(root, renderer.get(), name, buffer, _perf);
+        }
+    }
+
+    /*
+     * Swaps between consecutive variants are listed by the first shard.
+     * Variants chosen by the minimizer don't follow each other by a single
+     * swap, so the list is not written then.
+     */
+    std::ofstream swaps;
+    uint64_t      swapsSize = started ? checkpoint->swapsSize : 0;
+    char          line[64];
+
+    if (_options.variantOrder == VariantOrder::GrayCode &&
+        _options.shardIndex == 0 && minimizer == nullptr)
+    {
+        name.assign(path).append("/swaps.csv");
+        if (started)
+        {
+            if (truncate(name.c_str(), swapsSize) != 0)
+                return false;
+            swaps.open(name, std::ios::app);
+        }
+        else
+        {
+            static const char header[] = "variant,node,position\n";
+
+            swaps.open(name);
+            swaps.write(header, sizeof(header) - 1);
+            swapsSize += sizeof(header) - 1;
+        }
+    }
+
+    /*
+     * All shards walk the same permutation sequence, but each of them only
+     * renders and writes variants whose global index falls into its slice.
+     */
+    auto next = [this, &stream]() {
+        PerfScope scope(_perf, PerfStage::Permute);
+
+        return stream->next();
+    };
 
-    permute(root, 0, [root, &i, path]() {
-        std::ofstream ofs(path + "/" + std::to_string(i) + ".c");
+    allocations = getAllocationCount();
+    while (next())
+    {
+        if (minimizer != nullptr)
+        {
+            size_t spent = getAllocationCount();
+
+            offsets.push_back(deltas.size());
+            corpus->encodeVariant(i, deltas);
+            minimizer->add(*corpus);
+
+            /* Kept variants and orderings grow with the run, not per variant */
+            spent = getAllocationCount() - spent;
+            minimizerAllocations += spent;
+            allocations += spent;
+        }
+        else if (_options.ownsVariant(i))
+        {
+            buffer.clear();
+            if (_options.corpus)
+            {
+                {
+                    PerfScope scope(_perf, PerfStage::Render);
+
+                    corpus->encodeVariant(i, buffer);
+                }
+
+                PerfScope scope(_perf, PerfStage::Write);
+
+                ofs.write(buffer.data(), buffer.size());
+                outputSize += buffer.size();
+            }
+            else
+            {
+                name.assign(path).append("/").append(std::to_string(i))
+                    .append(".c");
+                writeProgram(root, renderer.get(), name, buffer, _perf);
+            }
+        }
+
+        size_t node;
+        size_t position;
+
+        if (swaps.is_open() && stream->lastSwap(node, position))
+        {
+            int length = std::snprintf(line, sizeof(line), "%zu,%zu,%zu\n",
+                                       i, node, position);
+
+            swaps.write(line, length);
+            swapsSize += length;
+        }
 
-        ofs << root->toString();
         i++;
-        return i == 100;
-    });
+        if (_perf != nullptr)
+            _perf->countVariant();
+
+        /* The first variant warms up buffers, the rest must not allocate */
+        size_t now = getAllocationCount();
+        if (i == 1)
+        {
+            warmupAllocations = now - allocations;
+        }
+        else
+        {
+            steadyAllocations += now - allocations;
+            maxAllocations = std::max(maxAllocations, now - allocations);
+        }
+        allocations = now;
+
+        if (i == _options.variantLimit)
+            break;
+
+        if (checkpoint != nullptr && i % _options.checkpointInterval == 0)
+        {
+            ofs.flush();
+            swaps.flush();
+            checkpoint->variant = i;
+            checkpoint->outputSize = outputSize;
+            checkpoint->swapsSize = swapsSize;
+            checkpoint->random.clear();
+            _random->saveState(checkpoint->random);
+            checkpoint->ordering.clear();
+            corpus->encodeVariant(i, checkpoint->ordering);
+            checkpoint->stream.clear();
+            stream->saveState(checkpoint->stream, nodes);
+            saveCheckpoint(*checkpoint);
+            allocations = getAllocationCount();
+        }
+    }
+
+    if (minimizer != nullptr)
+    {
+        std::vector<size_t> chosen = minimizer->select();
+
+        /* All shards choose the same variants and write their own slice */
+        offsets.push_back(deltas.size());
+        for (auto v : chosen)
+        {
+            const char *pos = deltas.data() + offsets[v];
+            const char *end = deltas.data() + offsets[v + 1];
+            size_t      index;
+
+            if (!_options.ownsVariant(v))
+                continue;
+
+            if (_options.corpus)
+            {
+                ofs.write(pos, end - pos);
+                continue;
+            }
+
+            if (!corpus->decodeVariant(pos, end, index))
+                return false;
+            name.assign(path).append("/").append(std::to_string(index))
+                .append(".c");
+            writeProgram(root, renderer.get(), name, buffer, _perf);
+        }
+        corpus->restorePrimary();
+
+        std::cout << "minimized " << i << " variants to " << chosen.size()
+                  << " covering " << minimizer->orderingCount()
+                  << " orderings" << std::endl;
+    }
+
+    if (_options.countAllocations)
+    {
+        std::cout << "allocations: program " << programAllocations
+                  << ", first variant " << warmupAllocations;
+        if (i > 1)
+        {
+            std::cout << ", per variant afterwards "
+                      << static_cast<double>(steadyAllocations) / (i - 1)
+                      << " (max " << maxAllocations << ", " << i - 1
+                      << " variants)";
+        }
+        if (_options.minimizeStrength != 0)
+            std::cout << ", minimizer " << minimizerAllocations;
+        std::cout << std::endl;
+    }
+    return true;
 }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,114 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Minimizer.hpp"
+#include <algorithm>
+#include <queue>
+#include "Serialization.hpp"
+
+namespace FuzzyTest
+{
+Minimizer::Minimizer(size_t strength) :
+  _strength(std::max<size_t>(strength, 2)), _offsets(1, 0)
+{
+}
+
+void
+Minimizer::add(const Corpus &corpus)
+{
+    size_t start = _orderings.size();
+
+    for (size_t node = 0; node < corpus.nodeCount(); ++node)
+    {
+        if (!corpus.getOrder(node, _order))
+            continue;
+
+        size_t length = std::min(_strength, _order.size());
+
+        for (size_t i = 0; i + length <= _order.size(); ++i)
+        {
+            size_t j = 1;
+
+            /* Runs in the primary order are covered by the primary program */
+            while (j < length && _order[i + j] == _order[i + j - 1] + 1)
+                j++;
+            if (j == length)
+                continue;
+
+            _key.clear();
+            putVarint(_key, node);
+            for (j = 0; j < length; ++j)
+                putVarint(_key, _order[i + j]);
+
+            auto it = _ids.emplace(_key, static_cast<uint32_t>(_ids.size()));
+            _orderings.push_back(it.first->second);
+        }
+    }
+
+    /* A variant may repeat an ordering at different positions */
+    std::sort(_orderings.begin() + start, _orderings.end());
+    _orderings.erase(std::unique(_orderings.begin() + start, _orderings.end()),
+                     _orderings.end());
+    _offsets.push_back(_orderings.size());
+}
+
+std::vector<size_t>
+Minimizer::select() const
+{
+    std::vector<uint64_t> covered((_ids.size() + 63) / 64, 0);
+    std::vector<size_t>   chosen;
+
+    /* Largest gain first, the earliest variant among equal gains */
+    auto later = [](const std::pair<size_t, size_t> &a,
+                    const std::pair<size_t, size_t> &b) {
+        return a.first < b.first || (a.first == b.first && a.second > b.second);
+    };
+    std::priority_queue<std::pair<size_t, size_t>,
+                        std::vector<std::pair<size_t, size_t>>,
+                        decltype(later)>
+        queue(later);
+
+    for (size_t v = 0; v < size(); ++v)
+    {
+        if (_offsets[v + 1] != _offsets[v])
+            queue.push({ _offsets[v + 1] - _offsets[v], v });
+    }
+
+    while (!queue.empty())
+    {
+        size_t variant = queue.top().second;
+        size_t gain = 0;
+
+        queue.pop();
+        for (size_t k = _offsets[variant]; k < _offsets[variant + 1]; ++k)
+        {
+            uint32_t id = _orderings[k];
+
+            if ((covered[id / 64] & (1ULL << (id % 64))) == 0)
+                gain++;
+        }
+
+        if (gain == 0)
+            continue;
+
+        /* A stale gain only overestimates, so the variant is still the best */
+        if (!queue.empty() && later({ gain, variant }, queue.top()))
+        {
+            queue.push({ gain, variant });
+            continue;
+        }
+
+        for (size_t k = _offsets[variant]; k < _offsets[variant + 1]; ++k)
+        {
+            uint32_t id = _orderings[k];
+
+            covered[id / 64] |= 1ULL << (id % 64);
+        }
+        chosen.push_back(variant);
+    }
+
+    std::sort(chosen.begin(), chosen.end());
+    return chosen;
+}
+}
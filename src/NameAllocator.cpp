@@ -0,0 +1,112 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "NameAllocator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace FuzzyTest
+{
+static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                              "abcdefghijklmnopqrstuvwxyz";
+static const char symbols[] = "0123456789"
+                              "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                              "abcdefghijklmnopqrstuvwxyz";
+
+/* 52 * 62^10 would not fit into 64 bits */
+static const size_t maxLength = 10;
+
+/* Sorted, so that a name is looked up by a binary search */
+static const char *const reserved[] = {
+    "NULL", "alignas", "alignof", "asm", "assert", "auto", "bool", "break",
+    "case", "char", "const", "constexpr", "continue", "default", "do",
+    "double", "else", "enum", "extern", "false", "float", "for", "goto", "if",
+    "inline", "int", "long", "main", "nullptr", "register", "restrict",
+    "return", "short", "signed", "sizeof", "static", "static_assert", "struct",
+    "switch", "thread_local", "true", "typedef", "typeof", "union", "unsigned",
+    "void", "volatile", "while",
+};
+
+/**
+ * @brief      Mix the bits of the value, see SplitMix64
+ */
+static uint64_t
+mix(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+static bool
+isReserved(const std::string &name)
+{
+    return std::binary_search(std::begin(reserved), std::end(reserved),
+                              name.c_str(),
+                              [](const char *a, const char *b) {
+                                  return std::strcmp(a, b) < 0;
+                              });
+}
+
+NameAllocator::NameAllocator(size_t length) :
+  _initialLength(std::min(std::max<size_t>(length, 1), maxLength)),
+  _length(_initialLength)
+{
+    startLength(_length);
+}
+
+void
+NameAllocator::reset(uint64_t seed)
+{
+    _seed = seed;
+    startLength(_initialLength);
+}
+
+void
+NameAllocator::startLength(size_t length)
+{
+    _length = length;
+    _space = sizeof(letters) - 1;
+    for (size_t i = 1; i < length; ++i)
+        _space *= sizeof(symbols) - 1;
+
+    /* Every length has its own permutation */
+    _multiplier = mix(_seed ^ length) % _space;
+    _offset = mix(_seed + length) % _space;
+    while (std::gcd(_multiplier, _space) != 1)
+        _multiplier = (_multiplier + 1) % _space;
+    _counter = 0;
+}
+
+std::string
+NameAllocator::next()
+{
+    std::string name(_length, 0);
+
+    do
+    {
+        if (_counter == _space && _length < maxLength)
+            startLength(_length + 1);
+        name.resize(_length);
+
+        /* The counter wraps around only after all names of 10 characters */
+        uint64_t value = static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(_multiplier) * _counter++ +
+             _offset) %
+            _space);
+
+        name[0] = letters[value % (sizeof(letters) - 1)];
+        value /= sizeof(letters) - 1;
+        for (size_t i = 1; i < _length; ++i)
+        {
+            name[i] = symbols[value % (sizeof(symbols) - 1)];
+            value /= sizeof(symbols) - 1;
+        }
+    } while (isReserved(name));
+
+    return name;
+}
+}
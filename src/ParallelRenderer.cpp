@@ -0,0 +1,269 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "ParallelRenderer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "Output.hpp"
+#include "PerfCounters.hpp"
+
+namespace FuzzyTest
+{
+/* Deeper nodes are rendered whole, there are enough pieces by then */
+static const int maxSplitDepth = 4;
+
+ParallelRenderer::ParallelRenderer(const std::shared_ptr<Syntax> &root,
+                                   unsigned                       threads,
+                                   PerfCounters                  *perf) :
+  _root(root), _threads(threads)
+{
+    if (_threads == 0)
+        _threads = std::max(1u, std::thread::hardware_concurrency());
+    split(_root.get(), 0);
+
+    /* The calling thread takes part in every job */
+    for (unsigned t = 1; t < _threads; ++t)
+        _workers.emplace_back(&ParallelRenderer::serve, this, perf);
+}
+
+ParallelRenderer::~ParallelRenderer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _stop = true;
+    }
+    _started.notify_all();
+    for (auto &worker : _workers)
+        worker.join();
+}
+
+void
+ParallelRenderer::split(Syntax *node, int depth)
+{
+    auto  &children = node->children();
+    auto   kind = node->getKind();
+    size_t start = _pieces.size();
+
+    if (depth < maxSplitDepth &&
+        (kind == SyntaxKind::Root || kind == SyntaxKind::Block))
+    {
+        /* The opening brace or an empty text marks the start of the node */
+        _pieces.push_back({ nullptr, kind == SyntaxKind::Block ? "{" : "",
+                            start, 0, '\0', 0 });
+        for (auto &ch : children)
+        {
+            split(ch.get(), depth + 1);
+            if (ch->getKind() != SyntaxKind::Function &&
+                ch->getKind() != SyntaxKind::Exact)
+                _pieces.push_back({ nullptr, nullptr, start, 0, '\0', 0 });
+        }
+        if (kind == SyntaxKind::Block)
+            _pieces.push_back({ nullptr, "}", start, 0, '\0', 0 });
+    }
+    else if (depth < maxSplitDepth && kind == SyntaxKind::Function &&
+             children.size() == 2 &&
+             children[1]->getKind() == SyntaxKind::Block)
+    {
+        /* See the Function case of Syntax::render() */
+        _pieces.push_back({ children[0].get(), nullptr, start, 0, '\0', 0 });
+        size_t mark = _pieces.size();
+        split(children[1].get(), depth + 1);
+        _pieces.push_back({ nullptr, nullptr, mark, 0, '\0', 0 });
+        _pieces.push_back({ nullptr, nullptr, start, 0, '\0', 0 });
+    }
+    else
+    {
+        _pieces.push_back({ node, nullptr, start, 0, '\0', 0 });
+    }
+}
+
+template <typename Function>
+void
+ParallelRenderer::callFunction(const void *function, Piece &piece)
+{
+    (*static_cast<const Function *>(function))(piece);
+}
+
+void
+ParallelRenderer::work()
+{
+    size_t i;
+
+    while ((i = _next++) < _pieces.size())
+    {
+        if (_pieces[i].node != nullptr)
+            _call(_function, _pieces[i]);
+    }
+}
+
+void
+ParallelRenderer::serve(PerfCounters *perf)
+{
+    PerfThread                   counters(perf);
+    std::unique_lock<std::mutex> lock(_mutex);
+    uint64_t                     done = 0;
+
+    while (true)
+    {
+        _started.wait(lock, [this, done]() { return _stop || _job != done; });
+        if (_stop)
+            return;
+        done = _job;
+
+        lock.unlock();
+        work();
+        counters.sample();
+        lock.lock();
+
+        if (--_busy == 0)
+            _finished.notify_one();
+    }
+}
+
+template <typename Function>
+void
+ParallelRenderer::forEachSubtree(const Function &function)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _call = &ParallelRenderer::callFunction<Function>;
+        _function = &function;
+        _next = 0;
+        _busy = static_cast<unsigned>(_workers.size());
+        _job++;
+    }
+    _started.notify_all();
+
+    work();
+
+    /* The function and the pieces must outlive every worker's share */
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _finished.wait(lock, [this]() { return _busy == 0; });
+}
+
+size_t
+ParallelRenderer::layout()
+{
+    size_t offset = 0;
+
+    if (_measured)
+        return _size;
+    char   last = '\0';
+
+    forEachSubtree([](Piece &piece) {
+        BufferOutput out(nullptr, 0);
+
+        piece.node->render(out);
+        piece.size = out.size();
+        piece.last = out.back();
+    });
+
+    for (auto &piece : _pieces)
+    {
+        piece.offset = offset;
+        if (piece.node == nullptr && piece.text != nullptr)
+        {
+            piece.size = std::strlen(piece.text);
+            if (piece.size != 0)
+                piece.last = piece.text[piece.size - 1];
+        }
+        else if (piece.node == nullptr)
+        {
+            /* The same decision as Syntax::ensureEOL() takes */
+            bool empty = offset == _pieces[piece.mark].offset;
+
+            piece.size = (empty || (last != ';' && last != '}')) ? 1 : 0;
+            piece.last = ';';
+        }
+
+        if (piece.size != 0)
+            last = piece.last;
+        offset += piece.size;
+    }
+
+    _measured = true;
+    _size = offset;
+    return offset;
+}
+
+bool
+ParallelRenderer::write(char *buffer)
+{
+    std::atomic<bool> fits(true);
+
+    for (auto &piece : _pieces)
+    {
+        if (piece.node == nullptr && piece.size != 0)
+        {
+            std::memcpy(buffer + piece.offset,
+                        piece.text != nullptr ? piece.text : ";",
+                        piece.size);
+        }
+    }
+
+    forEachSubtree([buffer, &fits](Piece &piece) {
+        BufferOutput out(buffer + piece.offset, piece.size);
+
+        piece.node->render(out);
+        if (out.size() != piece.size || out.back() != piece.last)
+            fits = false;
+    });
+
+    /* The layout is measured again the next time */
+    if (!fits)
+        _measured = false;
+    return fits;
+}
+
+void
+ParallelRenderer::render(std::string &out)
+{
+    do
+    {
+        out.resize(layout());
+    } while (!out.empty() && !write(&out[0]));
+}
+
+bool
+ParallelRenderer::renderToFile(const std::string &file)
+{
+    int  fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    bool written = false;
+
+    if (fd < 0)
+        return false;
+
+    while (!written)
+    {
+        size_t size = layout();
+        void  *map;
+
+        if (size == 0)
+            break;
+
+        if (ftruncate(fd, size) != 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+
+        written = write(static_cast<char *>(map));
+        munmap(map, size);
+    }
+    return close(fd) == 0;
+}
+}
@@ -0,0 +1,323 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "PerfCounters.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace FuzzyTest
+{
+static const char *stageNames[] = { "build", "obfuscate", "permute", "render",
+                                    "write" };
+
+/* Events in the order of the counters */
+static const uint32_t counterTypes[] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                         PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                         PERF_TYPE_SOFTWARE };
+static const uint64_t counterConfigs[] = { PERF_COUNT_HW_CPU_CYCLES,
+                                           PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_MISSES,
+                                           PERF_COUNT_HW_BRANCH_MISSES,
+                                           PERF_COUNT_SW_TASK_CLOCK };
+
+/**
+ * @brief      Open the counter of the calling thread
+ *
+ * @param      type    The event type
+ * @param      config  The event
+ * @param      group   The leader of the group to join, @c -1 to lead one
+ *
+ * @return     The file descriptor or @c -1
+ */
+static int
+openCounter(uint32_t type, uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+        PERF_FORMAT_TOTAL_TIME_RUNNING;
+    /* User space only, which does not require privileges */
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group,
+                                    PERF_FLAG_FD_CLOEXEC));
+}
+
+int
+PerfCounters::openCounters(int *fds, const int *wanted)
+{
+    int error = 0;
+
+    for (int i = 0; i < CounterCount; ++i)
+    {
+        bool hardware = counterTypes[i] == PERF_TYPE_HARDWARE;
+
+        /* Hardware counters are only opened along with their leader */
+        fds[i] = -1;
+        if ((wanted != nullptr && wanted[i] < 0) ||
+            (hardware && i != Cycles && fds[Cycles] < 0))
+            continue;
+
+        fds[i] = openCounter(counterTypes[i], counterConfigs[i],
+                             hardware && i != Cycles ? fds[Cycles] : -1);
+        if (fds[i] < 0 && i == Cycles)
+            error = errno;
+    }
+    return error;
+}
+
+bool
+PerfCounters::readCounters(const int *fds, Reading &last, uint64_t *counts)
+{
+    /* Number of counters and the times, then the counters in group order */
+    uint64_t data[3 + CounterCount];
+    bool     multiplexed = false;
+
+    for (int i = 0; i < CounterCount; ++i)
+        counts[i] = 0;
+
+    /* The leader reads the whole group at once */
+    if (fds[Cycles] >= 0 &&
+        read(fds[Cycles], data, sizeof(data)) >=
+            static_cast<ssize_t>(3 * sizeof(uint64_t)))
+    {
+        uint64_t enabled = data[1] - last.enabled;
+        uint64_t running = data[2] - last.running;
+        uint64_t n = 0;
+
+        for (int i = 0; i < CounterCount; ++i)
+        {
+            if (counterTypes[i] != PERF_TYPE_HARDWARE || fds[i] < 0 ||
+                n == data[0])
+                continue;
+
+            uint64_t value = data[3 + n++];
+
+            /* Not counted at all meanwhile, nothing to scale */
+            if (running != 0)
+            {
+                counts[i] = static_cast<uint64_t>(
+                    static_cast<double>(value - last.values[i]) * enabled /
+                    running);
+            }
+            last.values[i] = value;
+        }
+        multiplexed = running < enabled;
+        last.enabled = data[1];
+        last.running = data[2];
+    }
+
+    /* Software counters are never multiplexed, so they lead themselves */
+    for (int i = 0; i < CounterCount; ++i)
+    {
+        if (counterTypes[i] == PERF_TYPE_HARDWARE || fds[i] < 0 ||
+            read(fds[i], data, sizeof(data)) <
+                static_cast<ssize_t>(4 * sizeof(uint64_t)))
+            continue;
+
+        counts[i] = data[3] - last.values[i];
+        last.values[i] = data[3];
+    }
+    return multiplexed;
+}
+
+PerfCounters::PerfCounters()
+{
+    int error = openCounters(_fds, nullptr);
+
+    if (_fds[Cycles] < 0)
+        _error = std::strerror(error);
+
+    /* Stages rarely nest deeper, so entering them does not allocate */
+    _stack.reserve(16);
+    sample();
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (auto fd : _fds)
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+void
+PerfCounters::sample()
+{
+    auto     now = std::chrono::steady_clock::now();
+    uint64_t counts[CounterCount];
+
+    if (readCounters(_fds, _last, counts))
+        _multiplexed = true;
+
+    for (int i = 0; i < CounterCount; ++i)
+    {
+        uint64_t helpers = _pending[i].exchange(0, std::memory_order_relaxed);
+
+        if (!_stack.empty())
+        {
+            _totals[static_cast<size_t>(_stack.back())][i] +=
+                counts[i] + helpers;
+        }
+    }
+
+    if (!_stack.empty())
+    {
+        _wall[static_cast<size_t>(_stack.back())] +=
+            std::chrono::duration<double>(now - _lastTime).count();
+    }
+    _lastTime = now;
+}
+
+void
+PerfCounters::enter(PerfStage stage)
+{
+    sample();
+    _stack.push_back(stage);
+    _calls[static_cast<size_t>(stage)]++;
+}
+
+void
+PerfCounters::leave()
+{
+    sample();
+    _stack.pop_back();
+}
+
+void
+PerfCounters::report(std::ostream &out) const
+{
+    static const char *counterNames[] = { "cycles", "instructions",
+                                          "cache-misses", "branch-misses" };
+    uint64_t variantTotals[CounterCount] = {};
+    double   variantWall = 0;
+
+    auto printRow = [this, &out](const char *name, uint64_t calls,
+                                 double wall, const uint64_t *totals,
+                                 double scale) {
+        out << std::left << std::setw(12) << name << std::right
+            << std::setw(10) << calls << std::setw(14) << std::fixed
+            << std::setprecision(6) << wall * scale << std::setw(14)
+            << std::setprecision(3) << totals[TaskClock] * scale / 1e6;
+        for (int i = 0; i < TaskClock; ++i)
+        {
+            out << std::setw(15);
+            if (_fds[i] < 0)
+                out << "n/a";
+            else
+                out << std::setprecision(0) << totals[i] * scale;
+        }
+        out << std::setw(8);
+        if (_fds[Cycles] < 0 || _fds[Instructions] < 0 ||
+            totals[Cycles] == 0)
+            out << "n/a";
+        else
+            out << std::setprecision(2)
+                << static_cast<double>(totals[Instructions]) /
+                    totals[Cycles];
+        out << std::endl;
+    };
+
+    if (_fds[Cycles] < 0)
+    {
+        out << "hardware counters unavailable (" << _error
+            << "), reporting times only" << std::endl;
+    }
+    else if (_multiplexed)
+    {
+        out << "hardware counters were multiplexed, their counts are "
+               "estimates" << std::endl;
+    }
+
+    out << "counted threads: main";
+    if (_maxThreads != 0)
+        out << " and " << _maxThreads << " render threads";
+    out << std::endl;
+
+    out << std::left << std::setw(12) << "stage" << std::right
+        << std::setw(10) << "calls" << std::setw(14) << "wall, s"
+        << std::setw(14) << "cpu, ms";
+    for (auto name : counterNames)
+        out << std::setw(15) << name;
+    out << std::setw(8) << "IPC" << std::endl;
+
+    for (size_t s = 0; s < stageCount; ++s)
+    {
+        printRow(stageNames[s], _calls[s], _wall[s], _totals[s], 1.0);
+
+        /* Every variant is permuted, rendered and written */
+        if (s >= static_cast<size_t>(PerfStage::Permute))
+        {
+            variantWall += _wall[s];
+            for (int i = 0; i < CounterCount; ++i)
+                variantTotals[i] += _totals[s][i];
+        }
+    }
+
+    if (_variants != 0)
+    {
+        printRow("per variant", _variants, variantWall, variantTotals,
+                 1.0 / _variants);
+    }
+}
+
+PerfThread::PerfThread(PerfCounters *counters) : _counters(counters)
+{
+    uint64_t counts[PerfCounters::CounterCount];
+
+    /* Only what the calling thread counts is counted here */
+    for (auto &fd : _fds)
+        fd = -1;
+    if (_counters != nullptr)
+        PerfCounters::openCounters(_fds, _counters->_fds);
+    PerfCounters::readCounters(_fds, _last, counts);
+
+    if (_counters != nullptr)
+    {
+        unsigned threads = ++_counters->_threads;
+        unsigned most = _counters->_maxThreads;
+
+        while (most < threads &&
+               !_counters->_maxThreads.compare_exchange_weak(most, threads))
+            continue;
+    }
+}
+
+PerfThread::~PerfThread()
+{
+    for (auto fd : _fds)
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+    if (_counters != nullptr)
+        _counters->_threads--;
+}
+
+void
+PerfThread::sample()
+{
+    uint64_t counts[PerfCounters::CounterCount];
+
+    if (PerfCounters::readCounters(_fds, _last, counts))
+        _counters->_multiplexed = true;
+
+    for (int i = 0; i < PerfCounters::CounterCount; ++i)
+    {
+        if (_fds[i] >= 0)
+            _counters->_pending[i].fetch_add(counts[i],
+                                             std::memory_order_relaxed);
+    }
+}
+}
@@ -0,0 +1,94 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Process.hpp"
+#include <chrono>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace FuzzyTest
+{
+ProcessResult
+runCommand(const std::string &command, const std::string &file, bool capture)
+{
+    ProcessResult result;
+    std::string   line = command;
+    size_t        pos = 0;
+    bool          substituted = false;
+    pid_t         pid;
+    int           status;
+    int           fds[2] = { -1, -1 };
+    struct rusage usage;
+
+    while ((pos = line.find("{}", pos)) != std::string::npos)
+    {
+        line.replace(pos, 2, file);
+        pos += file.size();
+        substituted = true;
+    }
+    if (!substituted)
+        line += " " + file;
+
+    auto start = std::chrono::steady_clock::now();
+
+    /*
+     * Commands may run from several threads at once, a pipe inherited by
+     * another child would keep the reader waiting until that child exits
+     */
+    if (capture && pipe2(fds, O_CLOEXEC) != 0)
+        return result;
+
+    pid = fork();
+    if (pid < 0)
+    {
+        if (capture)
+        {
+            close(fds[0]);
+            close(fds[1]);
+        }
+        return result;
+    }
+
+    if (pid == 0)
+    {
+        if (capture)
+        {
+            dup2(fds[1], STDOUT_FILENO);
+            dup2(fds[1], STDERR_FILENO);
+            close(fds[0]);
+            close(fds[1]);
+        }
+        execl("/bin/sh", "sh", "-c", line.c_str(),
+              static_cast<char *>(nullptr));
+        _exit(127);
+    }
+
+    if (capture)
+    {
+        char    buffer[4096];
+        ssize_t got;
+
+        /* The output is drained first, so the command never blocks on it */
+        close(fds[1]);
+        while ((got = read(fds[0], buffer, sizeof(buffer))) > 0)
+            result.output.append(buffer, got);
+        close(fds[0]);
+    }
+
+    if (wait4(pid, &status, 0, &usage) < 0)
+        return result;
+
+    result.wallSeconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    /* On Linux the maximum resident set size is reported in kilobytes */
+    result.peakRssKb = usage.ru_maxrss;
+    if (WIFEXITED(status))
+        result.status = WEXITSTATUS(status);
+    return result;
+}
+}
@@ -0,0 +1,196 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Program.hpp"
+#include <new>
+#include "Output.hpp"
+#include "fuzzytest.h"
+
+namespace FuzzyTest
+{
+static std::shared_ptr<Syntax>
+createRoot(Generator                                      &generator,
+           const std::shared_ptr<RandomSource>            &random,
+           const Options                                  &options,
+           const std::shared_ptr<const ExpressionLibrary> &expressions)
+{
+    /* Just get the gears rolling, as the command line does */
+    random->next();
+    generator.setOptions(options);
+    generator.setRandomSource(random);
+    generator.setExpressions(expressions);
+
+    /* Variants are pulled one at a time, nothing selects them afterwards */
+    if (options.minimizeStrength != 0 || options.shardCount != 1)
+        return nullptr;
+
+    return options.isLargeProgram()
+        ? generator.generateLargeProgram(options.targetBytes,
+                                         options.targetNodes)
+        : generator.generateProgram();
+}
+
+Program::Program(unsigned int                             seed,
+                 const Options                           &options,
+                 std::shared_ptr<const ExpressionLibrary> expressions) :
+  _random(std::make_shared<SeededRandomSource>(seed)),
+  _root(createRoot(_generator, _random, options, expressions)),
+  _corpus(_root)
+{
+    /* Ordering keys of variants are drawn from here on every pass */
+    _random->saveState(_randomState);
+}
+
+size_t
+Program::size() const
+{
+    return render(nullptr, 0);
+}
+
+size_t
+Program::render(char *buffer, size_t capacity) const
+{
+    BufferOutput out(buffer, capacity);
+
+    _root->render(out);
+    return out.size();
+}
+
+size_t
+Program::forEachVariant(char                                      *buffer,
+                        size_t                                      capacity,
+                        const std::function<bool(size_t, size_t)> &callback)
+{
+    size_t i = 0;
+    size_t limit = _generator.options().variantLimit;
+
+    rewind();
+
+    VariantStream stream(_generator, _root, _generator.options().variantOrder);
+
+    while (stream.next())
+    {
+        size_t size = render(buffer, capacity);
+        bool   stop = callback(i, size);
+
+        i++;
+        if (stop || i == limit)
+            break;
+    }
+    _corpus.restorePrimary();
+    return i;
+}
+
+bool
+Program::nextVariant(char *buffer, size_t capacity, size_t &size)
+{
+    size_t limit = _generator.options().variantLimit;
+
+    if (_stream == nullptr)
+        _stream.reset(new VariantStream(_generator, _root,
+                                        _generator.options().variantOrder));
+
+    if (limit != 0 && _stream->count() == limit)
+        return false;
+
+    if (!_stream->next())
+        return false;
+
+    size = render(buffer, capacity);
+    return true;
+}
+
+void
+Program::rewind()
+{
+    const char *pos = _randomState.data();
+
+    _stream.reset();
+    _corpus.restorePrimary();
+    _random->restoreState(pos, pos + _randomState.size());
+}
+}
+
+using namespace FuzzyTest;
+
+struct fuzzytest_program
+{
+    Program program;
+
+    fuzzytest_program(unsigned int seed, const Options &options) :
+      program(seed, options)
+    {
+    }
+};
+
+extern "C" fuzzytest_program *
+fuzzytest_program_create(unsigned int seed, size_t variant_limit)
+{
+    Options options;
+
+    options.variantLimit = variant_limit;
+
+    auto program = new (std::nothrow) fuzzytest_program(seed, options);
+
+    if (program != nullptr && !program->program.isValid())
+    {
+        delete program;
+        return nullptr;
+    }
+    return program;
+}
+
+extern "C" void
+fuzzytest_program_destroy(fuzzytest_program *program)
+{
+    delete program;
+}
+
+extern "C" size_t
+fuzzytest_program_size(const fuzzytest_program *program)
+{
+    return program->program.size();
+}
+
+extern "C" size_t
+fuzzytest_program_render(const fuzzytest_program *program,
+                         char                    *buffer,
+                         size_t                   capacity)
+{
+    return program->program.render(buffer, capacity);
+}
+
+extern "C" int
+fuzzytest_program_next_variant(fuzzytest_program *program,
+                               char              *buffer,
+                               size_t             capacity,
+                               size_t            *size)
+{
+    size_t full;
+
+    if (!program->program.nextVariant(buffer, capacity, full))
+        return 0;
+    if (size != nullptr)
+        *size = full;
+    return 1;
+}
+
+extern "C" void
+fuzzytest_program_rewind(fuzzytest_program *program)
+{
+    program->program.rewind();
+}
+
+extern "C" size_t
+fuzzytest_program_variants(fuzzytest_program         *program,
+                           char                      *buffer,
+                           size_t                     capacity,
+                           fuzzytest_variant_callback callback,
+                           void                      *context)
+{
+    return program->program.forEachVariant(
+        buffer, capacity, [callback, context](size_t index, size_t size) {
+            return callback(context, index, size) != 0;
+        });
+}
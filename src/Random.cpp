@@ -0,0 +1,135 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Random.hpp"
+#include <algorithm>
+#include "Serialization.hpp"
+
+namespace FuzzyTest
+{
+SeededRandomSource::SeededRandomSource(unsigned int seed)
+{
+    int32_t word;
+
+    if (seed == 0)
+        seed = 1;
+
+    word = static_cast<int32_t>(seed);
+    _state[0] = word;
+    for (int i = 1; i < degree; ++i)
+    {
+        /* 16807 * word % 2147483647 without overflowing 31 bits */
+        long hi = word / 127773;
+        long lo = word % 127773;
+
+        word = static_cast<int32_t>(16807 * lo - 2836 * hi);
+        if (word < 0)
+            word += 2147483647;
+        _state[i] = word;
+    }
+
+    for (int i = 0; i < degree * 10; ++i)
+        next();
+}
+
+uint32_t
+SeededRandomSource::next()
+{
+    uint32_t value = static_cast<uint32_t>(_state[_front]) +
+        static_cast<uint32_t>(_state[_rear]);
+
+    _state[_front] = static_cast<int32_t>(value);
+    _front = (_front + 1) % degree;
+    _rear = (_rear + 1) % degree;
+    return value >> 1;
+}
+
+bool
+SeededRandomSource::saveState(std::string &out) const
+{
+    for (int i = 0; i < degree; ++i)
+        putVarint(out, static_cast<uint32_t>(_state[i]));
+    putVarint(out, _front);
+    putVarint(out, _rear);
+    return true;
+}
+
+bool
+SeededRandomSource::restoreState(const char *&pos, const char *end)
+{
+    int32_t  state[degree];
+    uint64_t front;
+    uint64_t rear;
+    uint64_t value;
+
+    for (int i = 0; i < degree; ++i)
+    {
+        if (!getVarint(pos, end, value) || value > 0xFFFFFFFFULL)
+            return false;
+        state[i] = static_cast<int32_t>(static_cast<uint32_t>(value));
+    }
+
+    /* The distance between both ends never changes */
+    if (!getVarint(pos, end, front) || !getVarint(pos, end, rear) ||
+        front >= degree || rear >= degree ||
+        (rear + separation) % degree != front)
+        return false;
+
+    std::copy(state, state + degree, _state);
+    _front = front;
+    _rear = rear;
+    return true;
+}
+
+ByteStreamRandomSource::ByteStreamRandomSource(const uint8_t *data,
+                                               size_t         size) :
+  _data(data), _size(size)
+{
+    /* FNV-1a of the stream seeds the generator used after it is exhausted */
+    _state = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        _state ^= data[i];
+        _state *= 0x100000001b3ULL;
+    }
+    if (_state == 0)
+        _state = 1;
+}
+
+uint32_t
+ByteStreamRandomSource::take(size_t bytes)
+{
+    uint32_t value = 0;
+
+    if (_pos + bytes > _size)
+    {
+        /* xorshift64* */
+        _pos = _size;
+        _state ^= _state >> 12;
+        _state ^= _state << 25;
+        _state ^= _state >> 27;
+        return static_cast<uint32_t>((_state * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+    for (size_t i = 0; i < bytes; ++i)
+        value |= static_cast<uint32_t>(_data[_pos++]) << (8 * i);
+    return value;
+}
+
+uint32_t
+ByteStreamRandomSource::next()
+{
+    return take(4) % (static_cast<uint32_t>(RAND_MAX) + 1);
+}
+
+uint32_t
+ByteStreamRandomSource::next(uint32_t bound)
+{
+    if (bound <= 0x100)
+        return take(1) % bound;
+    if (bound <= 0x10000)
+        return take(2) % bound;
+    return take(4) % bound;
+}
+}
@@ -0,0 +1,270 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Search.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "Generator.hpp"
+#include "Process.hpp"
+
+namespace FuzzyTest
+{
+/* Limits of the generator decisions explored by the search */
+static const int maxObfuscationDepth = 32;
+static const int maxBranches = 32;
+static const int maxBranchWeight = 8;
+static const int minLiteralPercent = 50;
+
+Search::Search(const Options &options, unsigned long long seed) :
+  _options(options), _random(seed)
+{
+}
+
+Search::Individual
+Search::random()
+{
+    Individual individual;
+
+    individual.seed = _random();
+    individual.options = _options;
+    individual.options.obfuscationBranch = -1;
+    individual.options.obfuscationDepth =
+        1 + _random() % maxObfuscationDepth;
+    individual.options.switchCases = _random() % (maxBranches + 1);
+    individual.options.ifGroupLength = _random() % (maxBranches + 1);
+    individual.options.literalPercent =
+        minLiteralPercent + _random() % (100 - minLiteralPercent + 1);
+    for (auto &weight : individual.options.branchWeights)
+        weight = _random() % (maxBranchWeight + 1);
+    individual.wallSeconds = 0;
+    return individual;
+}
+
+Search::Individual
+Search::crossover(const Individual &a, const Individual &b)
+{
+    Individual child = a;
+
+    /* Uniform crossover, every decision comes from a random parent */
+    if (_random() % 2)
+        child.seed = b.seed;
+    if (_random() % 2)
+        child.options.obfuscationDepth = b.options.obfuscationDepth;
+    if (_random() % 2)
+        child.options.switchCases = b.options.switchCases;
+    if (_random() % 2)
+        child.options.ifGroupLength = b.options.ifGroupLength;
+    if (_random() % 2)
+        child.options.literalPercent = b.options.literalPercent;
+    for (size_t i = 0; i < child.options.branchWeights.size(); ++i)
+    {
+        if (_random() % 2)
+            child.options.branchWeights[i] = b.options.branchWeights[i];
+    }
+    child.program.clear();
+    child.wallSeconds = 0;
+    return child;
+}
+
+void
+Search::mutate(Individual &individual)
+{
+    auto nudge = [this](int value, int low, int high) {
+        value += static_cast<int>(_random() % 9) - 4;
+        return std::min(std::max(value, low), high);
+    };
+    auto &options = individual.options;
+
+    if (_random() % 4 == 0)
+        individual.seed = _random();
+    if (_random() % 4 == 0)
+        options.obfuscationDepth =
+            nudge(options.obfuscationDepth, 1, maxObfuscationDepth);
+    if (_random() % 4 == 0)
+        options.switchCases = nudge(options.switchCases, 0, maxBranches);
+    if (_random() % 4 == 0)
+        options.ifGroupLength = nudge(options.ifGroupLength, 0, maxBranches);
+    if (_random() % 4 == 0)
+        options.literalPercent =
+            nudge(options.literalPercent, minLiteralPercent, 100);
+    if (_random() % 4 == 0)
+    {
+        options.branchWeights[_random() % options.branchWeights.size()] =
+            _random() % (maxBranchWeight + 1);
+    }
+}
+
+bool
+Search::evaluate(Individual          &individual,
+                 const SearchOptions &search,
+                 const std::string   &file)
+{
+    std::vector<double> runTimes;
+
+    Generator generator;
+    auto      found = _expressions.find(individual.options.literalPercent);
+
+    /* Mutations only change the literal percentage of the library */
+    if (found == _expressions.end())
+    {
+        std::shared_ptr<const ExpressionLibrary> library;
+
+        if (!Generator::loadExpressions(individual.options, library))
+            return false;
+        found = _expressions.emplace(individual.options.literalPercent,
+                                     library).first;
+    }
+
+    generator.setOptions(individual.options);
+    generator.setExpressions(found->second);
+    std::srand(individual.seed);
+    std::rand();
+
+    auto root = individual.options.isLargeProgram()
+        ? generator.generateLargeProgram(individual.options.targetBytes,
+                                         individual.options.targetNodes)
+        : generator.generateProgram();
+
+    if (root == nullptr)
+        return false;
+
+    individual.program = root->toString();
+    {
+        std::ofstream ofs(file);
+
+        ofs << individual.program;
+    }
+
+    /* Median is less sensitive to the noise than a single run */
+    for (unsigned rep = 0; rep < search.repeat; ++rep)
+        runTimes.push_back(runCommand(search.command, file).wallSeconds);
+    std::sort(runTimes.begin(), runTimes.end());
+    individual.wallSeconds = runTimes[runTimes.size() / 2];
+    return true;
+}
+
+/**
+ * @brief      Append the arguments regenerating the program
+ *
+ * @param      seed     The seed of the program
+ * @param      options  The options of the generator
+ * @param      out      The output
+ */
+static void
+putArguments(unsigned long long seed, const Options &options, std::ostream &out)
+{
+    out << "--seed " << seed;
+    if (options.targetBytes != 0)
+        out << " --target-bytes " << options.targetBytes;
+    if (options.targetNodes != 0)
+        out << " --target-nodes " << options.targetNodes;
+    if (options.goals != 0)
+        out << " --goals " << options.goals;
+    if (options.goalFunctions != 1)
+        out << " --goal-functions " << options.goalFunctions;
+    if (options.expressions != 0)
+        out << " --expressions " << options.expressions;
+    if (!options.expressionFile.empty())
+        out << " --expressions-file " << options.expressionFile;
+    if (options.obfuscationBranch != -1)
+        out << " --obfuscation-branch " << options.obfuscationBranch;
+
+    out << " --obfuscation-depth " << options.obfuscationDepth
+        << " --switch-cases " << options.switchCases << " --if-branches "
+        << options.ifGroupLength << " --literal-percent "
+        << options.literalPercent << " --branch-weights ";
+    for (size_t i = 0; i < options.branchWeights.size(); ++i)
+        out << (i == 0 ? "" : ",") << options.branchWeights[i];
+}
+
+bool
+Search::save(const std::vector<Individual> &population,
+             const std::string             &path)
+{
+    std::ofstream csv(path + "/population.csv");
+
+    if (!csv.is_open())
+        return false;
+
+    csv << "rank,wall_seconds,bytes,arguments" << std::endl;
+    for (size_t i = 0; i < population.size(); ++i)
+    {
+        auto &individual = population[i];
+
+        {
+            std::ofstream ofs(path + "/" + std::to_string(i) + ".c");
+
+            ofs << individual.program;
+        }
+        csv << i << "," << individual.wallSeconds << ","
+            << individual.program.size() << ",\"";
+        putArguments(individual.seed, individual.options, csv);
+        csv << "\"" << std::endl;
+    }
+    return true;
+}
+
+bool
+Search::run(const SearchOptions &search, const std::string &path)
+{
+    std::vector<Individual> population;
+    std::string             populationPath = path + "/population";
+    std::string             file = path + "/candidate.c";
+    std::error_code         ec;
+
+    std::filesystem::create_directories(populationPath, ec);
+    if (ec)
+        return false;
+
+    auto slowerFirst = [](const Individual &a, const Individual &b) {
+        return a.wallSeconds > b.wallSeconds;
+    };
+    auto tournament = [this, &population]() -> const Individual & {
+        auto &a = population[_random() % population.size()];
+        auto &b = population[_random() % population.size()];
+
+        return a.wallSeconds > b.wallSeconds ? a : b;
+    };
+
+    for (unsigned i = 0; i < search.population; ++i)
+    {
+        population.push_back(random());
+        if (!evaluate(population.back(), search, file))
+            return false;
+    }
+    std::sort(population.begin(), population.end(), slowerFirst);
+    if (!save(population, populationPath))
+        return false;
+
+    for (unsigned generation = 1; generation <= search.generations;
+         ++generation)
+    {
+        std::vector<Individual> children;
+
+        for (unsigned i = 0; i < search.population; ++i)
+        {
+            children.push_back(crossover(tournament(), tournament()));
+            mutate(children.back());
+            if (!evaluate(children.back(), search, file))
+                return false;
+        }
+
+        /* The slowest programs among parents and children survive */
+        population.insert(population.end(), children.begin(),
+                          children.end());
+        std::sort(population.begin(), population.end(), slowerFirst);
+        population.resize(search.population);
+        if (!save(population, populationPath))
+            return false;
+
+        std::cout << "generation " << generation << ": slowest "
+                  << population.front().wallSeconds << " s, seed "
+                  << population.front().seed << std::endl;
+    }
+    return true;
+}
+}
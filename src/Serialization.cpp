@@ -0,0 +1,173 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Serialization.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace FuzzyTest
+{
+/*
+ * Every node starts with a tag:
+ *   0                   - null child
+ *   (id << 1) | 1       - reference to an already written node
+ *   (kind + 1) << 1     - new node followed by its value and children
+ */
+
+void
+putVarint(std::string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool
+getVarint(const char *&pos, const char *end, uint64_t &value)
+{
+    int shift = 0;
+
+    value = 0;
+    while (pos < end && shift < 64)
+    {
+        uint8_t byte = static_cast<uint8_t>(*pos++);
+
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+        shift += 7;
+    }
+    return false;
+}
+
+static void
+serializeNode(const std::shared_ptr<Syntax>          &node,
+              std::unordered_map<const Syntax *, uint64_t> &ids,
+              std::string                             &out)
+{
+    if (node == nullptr)
+    {
+        putVarint(out, 0);
+        return;
+    }
+
+    auto it = ids.find(node.get());
+    if (it != ids.end())
+    {
+        putVarint(out, (it->second << 1) | 1);
+        return;
+    }
+
+    ids.emplace(node.get(), ids.size());
+    putVarint(out, (static_cast<uint64_t>(node->getKind()) + 1) << 1);
+
+    const std::string &value = node->getStringValue();
+    putVarint(out, value.size());
+    out.append(value);
+
+    putVarint(out, node->children().size());
+    for (auto &ch : node->children())
+    {
+        serializeNode(ch, ids, out);
+    }
+}
+
+void
+serializeTree(const std::shared_ptr<Syntax> &root, std::string &out)
+{
+    std::unordered_map<const Syntax *, uint64_t> ids;
+
+    serializeNode(root, ids, out);
+}
+
+/* Rendering recurses into children, deeper trees are not written */
+static const unsigned maxDepth = 4096;
+
+/**
+ * @brief      Read the node and its children
+ *
+ * @param      pos       The current position, advanced past the node
+ * @param      end       The end of the buffer
+ * @param      nodes     The nodes read so far, in the order they were written
+ * @param      finished  Whether all children of each node were read
+ * @param      depth     The depth of the node
+ * @param      result    The node
+ *
+ * @return     @c false if the data is malformed
+ */
+static bool
+deserializeNode(const char                           *&pos,
+                const char                            *end,
+                std::vector<std::shared_ptr<Syntax>> &nodes,
+                std::vector<char>                    &finished,
+                unsigned                              depth,
+                std::shared_ptr<Syntax>              &result)
+{
+    uint64_t tag;
+    uint64_t length;
+    uint64_t count;
+    size_t   index;
+
+    if (depth > maxDepth || !getVarint(pos, end, tag))
+        return false;
+
+    if (tag == 0)
+    {
+        result = nullptr;
+        return true;
+    }
+
+    /* A node still being read is an ancestor, referring to it is a cycle */
+    if ((tag & 1) != 0)
+    {
+        if ((tag >> 1) >= nodes.size() || finished[tag >> 1] == 0)
+            return false;
+        result = nodes[tag >> 1];
+        return true;
+    }
+
+    if ((tag >> 1) - 1 > static_cast<uint64_t>(SyntaxKind::Call))
+        return false;
+
+    if (!getVarint(pos, end, length) ||
+        length > static_cast<uint64_t>(end - pos))
+        return false;
+
+    result = Syntax::create(static_cast<SyntaxKind>((tag >> 1) - 1),
+                            std::string(pos, length));
+    pos += length;
+    index = nodes.size();
+    nodes.push_back(result);
+    finished.push_back(0);
+
+    if (!getVarint(pos, end, count))
+        return false;
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        std::shared_ptr<Syntax> child;
+
+        if (!deserializeNode(pos, end, nodes, finished, depth + 1, child))
+            return false;
+        result->add(child);
+    }
+    finished[index] = 1;
+    return true;
+}
+
+std::shared_ptr<Syntax>
+deserializeTree(const char *&pos, const char *end)
+{
+    std::vector<std::shared_ptr<Syntax>> nodes;
+    std::vector<char>                    finished;
+    std::shared_ptr<Syntax>              root;
+
+    if (!deserializeNode(pos, end, nodes, finished, 0, root))
+        return nullptr;
+    return root;
+}
+}
@@ -0,0 +1,468 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Server.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "Program.hpp"
+
+namespace FuzzyTest
+{
+/* Pause before accepting again when the process runs out of resources */
+static const std::chrono::milliseconds acceptBackoff(100);
+
+/** Rendered program or variant waiting to be served */
+struct PrefetchItem
+{
+    uint32_t    seed;
+    uint64_t    index;
+    std::string data;
+};
+
+/**
+ * @brief      Bounded queue filled by a producer thread.
+ *
+ * Slots are allocated once and their buffers are reused, the producer
+ * renders straight into the free slot and the consumer sends straight from
+ * the taken one, so nothing is copied or allocated in the steady state.
+ */
+class PrefetchQueue
+{
+public:
+    explicit PrefetchQueue(unsigned capacity) : _slots(capacity)
+    {
+    }
+
+    /**
+     * @brief      Wait for a free slot
+     *
+     * @return     The slot or @c nullptr if the queue is stopped
+     */
+    PrefetchItem *acquire()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _notFull.wait(lock,
+                      [this]() { return _stop || _count < _slots.size(); });
+        if (_stop)
+            return nullptr;
+        return &_slots[(_head + _count) % _slots.size()];
+    }
+
+    /**
+     * @brief      Make the slot returned by acquire() available
+     */
+    void publish()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _count++;
+        _notEmpty.notify_one();
+    }
+
+    /**
+     * @brief      Wait for the next item, it stays valid until release()
+     *
+     * @return     The item
+     */
+    const PrefetchItem &take()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _notEmpty.wait(lock, [this]() { return _count > 0; });
+        return _slots[_head];
+    }
+
+    /**
+     * @brief      Give the item returned by take() back to the producer
+     */
+    void release()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _head = (_head + 1) % _slots.size();
+        _count--;
+        _notFull.notify_one();
+    }
+
+    /**
+     * @brief      Stop the producer
+     */
+    void stop()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _stop = true;
+        _notFull.notify_one();
+    }
+
+private:
+    std::vector<PrefetchItem> _slots;
+    size_t                    _head = 0;
+    size_t                    _count = 0;
+    bool                      _stop = false;
+    std::mutex                _mutex;
+    std::condition_variable   _notEmpty;
+    std::condition_variable   _notFull;
+};
+
+static bool
+readAll(int fd, void *data, size_t size)
+{
+    char *pos = static_cast<char *>(data);
+
+    while (size > 0)
+    {
+        ssize_t got = read(fd, pos, size);
+
+        if (got <= 0)
+            return false;
+        pos += got;
+        size -= got;
+    }
+    return true;
+}
+
+static void
+putLE(char *out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+        out[i] = static_cast<char>(value >> (8 * i));
+}
+
+static uint64_t
+getLE(const char *in, size_t bytes)
+{
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < bytes; ++i)
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+    return value;
+}
+
+/**
+ * @brief      Send the response
+ *
+ * @param      fd      The client socket
+ * @param      status  The status, @c 'O' or @c 'E'
+ * @param      seed    The seed of the program
+ * @param      index   The index of the item
+ * @param      data    The program
+ * @param      size    The size of the program
+ *
+ * @return     @c false if the client is gone
+ */
+static bool
+respond(int         fd,
+        char        status,
+        uint32_t    seed,
+        uint64_t    index,
+        const char *data,
+        size_t      size)
+{
+    char         header[17];
+    struct iovec iov[2];
+    size_t       left = sizeof(header) + size;
+    int          count = 2;
+
+    header[0] = status;
+    putLE(header + 1, seed, 4);
+    putLE(header + 5, index, 8);
+    putLE(header + 13, size, 4);
+
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = const_cast<char *>(data);
+    iov[1].iov_len = size;
+
+    struct iovec *pos = iov;
+    while (left > 0)
+    {
+        ssize_t written = writev(fd, pos, count);
+
+        if (written <= 0)
+            return false;
+        left -= written;
+
+        /* Skip what was written, partially written vectors are adjusted */
+        while (count > 0 && static_cast<size_t>(written) >= pos->iov_len)
+        {
+            written -= pos->iov_len;
+            pos++;
+            count--;
+        }
+        if (count > 0)
+        {
+            pos->iov_base = static_cast<char *>(pos->iov_base) + written;
+            pos->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief      Fill the queue with programs of seeds drawn from the sequence
+ *
+ * @param      queue        The queue
+ * @param      options      The options of the generator
+ * @param      expressions  The expression library prepared for the options
+ * @param      nextSeed     The sequence of seeds
+ */
+static void
+produce(PrefetchQueue                                  &queue,
+        const Options                                  &options,
+        const std::shared_ptr<const ExpressionLibrary> &expressions,
+        std::atomic<unsigned long long>                &nextSeed)
+{
+    while (true)
+    {
+        uint32_t      seed = static_cast<uint32_t>(nextSeed++);
+        Program       program(seed, options, expressions);
+        size_t        size;
+        size_t        full;
+        PrefetchItem *item;
+
+        /* Options are checked before serving, so this is not expected */
+        if (!program.isValid() || (item = queue.acquire()) == nullptr)
+            return;
+
+        size = program.size();
+
+        item->seed = seed;
+        item->index = 0;
+        item->data.resize(size);
+        program.render(&item->data[0], size);
+        queue.publish();
+
+        for (uint64_t index = 1;; ++index)
+        {
+            if ((item = queue.acquire()) == nullptr)
+                return;
+
+            /* The slot stays free if there are no more variants */
+            item->data.resize(size);
+            if (!program.nextVariant(&item->data[0], size, full))
+                break;
+
+            item->seed = seed;
+            item->index = index;
+            queue.publish();
+        }
+    }
+}
+
+Server::Server(const Options &options, unsigned long long seed) :
+  _options(options), _nextSeed(seed)
+{
+}
+
+void
+Server::serveClient(int fd, unsigned prefetch)
+{
+    PrefetchQueue            queue(prefetch);
+    std::thread              producer(produce, std::ref(queue),
+                                      std::cref(_options),
+                                      std::cref(_expressions),
+                                      std::ref(_nextSeed));
+    std::unique_ptr<Program> program;
+    uint32_t                 programSeed = 0;
+    uint64_t                 position = 0;
+    std::string              buffer;
+    char                     command;
+    char                     request[12];
+
+    while (readAll(fd, &command, 1))
+    {
+        bool sent;
+
+        if (command == 'N')
+        {
+            const PrefetchItem &item = queue.take();
+
+            sent = respond(fd, 'O', item.seed, item.index, item.data.data(),
+                           item.data.size());
+            queue.release();
+        }
+        else if (command == 'G' && readAll(fd, request, sizeof(request)))
+        {
+            uint32_t seed = getLE(request, 4);
+            uint64_t index = getLE(request + 4, 8);
+            size_t   size;
+            bool     found = true;
+
+            /*
+             * The program of the last request is kept, so walking the
+             * variants of one program in order costs one step per request.
+             */
+            if (program == nullptr || programSeed != seed || index < position)
+            {
+                program.reset(new Program(seed, _options, _expressions));
+                programSeed = seed;
+                position = 0;
+                found = program->isValid();
+            }
+
+            while (position < index && found)
+            {
+                found = program->nextVariant(nullptr, 0, size);
+                position += found ? 1 : 0;
+            }
+
+            if (found)
+            {
+                buffer.resize(program->size());
+                program->render(&buffer[0], buffer.size());
+                sent = respond(fd, 'O', seed, index, buffer.data(),
+                               buffer.size());
+            }
+            else
+            {
+                sent = respond(fd, 'E', seed, index, nullptr, 0);
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        if (!sent)
+            break;
+    }
+
+    queue.stop();
+    producer.join();
+    close(fd);
+}
+
+bool
+Server::run(const ServerOptions &server)
+{
+    const std::string &address = server.address;
+    int                fd;
+    bool               tcp = server.port != 0;
+
+    /* Every program of every client uses the same library */
+    if (!Generator::loadExpressions(_options, _expressions))
+    {
+        std::cerr << "Failed to load expressions " << _options.expressionFile
+                  << std::endl;
+        return false;
+    }
+
+    /* Clients going away must not kill the server */
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (tcp)
+    {
+        struct sockaddr_in addr;
+        int                one = 1;
+
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(server.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return false;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                 sizeof(addr)) != 0)
+        {
+            close(fd);
+            return false;
+        }
+    }
+    else
+    {
+        struct sockaddr_un addr;
+
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(addr.sun_path))
+            return false;
+        std::strcpy(addr.sun_path, address.c_str());
+
+        /* A stale socket of an earlier run is replaced, nothing else is */
+        struct stat st;
+
+        if (lstat(address.c_str(), &st) == 0)
+        {
+            if (!S_ISSOCK(st.st_mode))
+            {
+                std::cerr << address << " exists and is not a socket"
+                          << std::endl;
+                return false;
+            }
+            unlink(address.c_str());
+        }
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return false;
+        if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                 sizeof(addr)) != 0)
+        {
+            close(fd);
+            return false;
+        }
+    }
+
+    if (listen(fd, SOMAXCONN) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    while (true)
+    {
+        int client = accept(fd, nullptr, nullptr);
+
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            /* Out of descriptors or memory, wait for clients to go away */
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+                errno == ENOMEM)
+            {
+                std::this_thread::sleep_for(acceptBackoff);
+                continue;
+            }
+
+            std::cerr << "Failed to accept clients: " << std::strerror(errno)
+                      << std::endl;
+            close(fd);
+            return false;
+        }
+
+        if (tcp)
+        {
+            int one = 1;
+
+            /* Responses are written at once, so waiting only adds latency */
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        std::thread(&Server::serveClient, this, client,
+                    server.prefetch).detach();
+    }
+}
+}
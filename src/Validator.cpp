@@ -0,0 +1,280 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "Validator.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "Generator.hpp"
+#include "Process.hpp"
+
+namespace FuzzyTest
+{
+Validator::Validator(const Options &options, unsigned long long seed) :
+  _options(options), _seed(seed)
+{
+}
+
+void
+Validator::collectNames(const std::shared_ptr<Syntax> &node,
+                        std::vector<Renamed>          &renamed)
+{
+    if (node == nullptr)
+        return;
+
+    if (node->getKind() == SyntaxKind::FunctionProto &&
+        node->children().size() >= 2)
+    {
+        auto &name = node->children()[1];
+
+        renamed.push_back({ name, name->getStringValue() });
+    }
+    else if (node->getKind() == SyntaxKind::Call)
+    {
+        renamed.push_back({ node, node->getStringValue() });
+    }
+
+    for (auto &ch : node->children())
+    {
+        collectNames(ch, renamed);
+    }
+}
+
+void
+Validator::append(const std::shared_ptr<Syntax> &root,
+                  const std::vector<Renamed>    &renamed,
+                  size_t                         program,
+                  long long                      variant,
+                  std::string                   &out)
+{
+    std::string id = std::to_string(program) + "/" +
+        (variant < 0 ? std::string("_primary") : std::to_string(variant));
+    std::string suffix = "_" + std::to_string(program) + "_" +
+        (variant < 0 ? std::string("p") : std::to_string(variant));
+    auto       &children = root->children();
+
+    for (auto &r : renamed)
+        r.node->setStringValue(r.name + suffix);
+
+    /* Diagnostics name the file the program would be written to */
+    out.append("#line 1 \"").append(id).append(".c\"\n");
+
+    /* The prelude is shared by all programs of the translation unit */
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        size_t mark = out.size();
+        auto   kind = children[i]->getKind();
+
+        if (i == 0 && kind == SyntaxKind::Exact)
+            continue;
+
+        children[i]->render(out);
+        if (kind != SyntaxKind::Function && kind != SyntaxKind::Exact)
+            Syntax::ensureEOL(out, mark);
+    }
+    out.push_back('\n');
+
+    for (auto &r : renamed)
+        r.node->setStringValue(r.name);
+}
+
+/**
+ * @brief      Report diagnostics of one compiled translation unit
+ *
+ * @param      file    The translation unit
+ * @param      result  The result of the compiler
+ *
+ * @return     @c true if the translation unit compiled
+ */
+static bool
+report(const std::string &file, const ProcessResult &result)
+{
+    std::map<std::string, std::vector<std::string>> diagnostics;
+    std::istringstream                               iss(result.output);
+    std::string                                      line;
+
+    while (std::getline(iss, line))
+    {
+        size_t slash = line.find('/');
+        size_t colon = line.find(".c:");
+
+        /*
+         * Only errors located in one of the programs are mapped, warnings
+         * are reported only if the command turns them into errors.
+         */
+        if (slash == std::string::npos || colon == std::string::npos ||
+            slash > colon || line.find_first_not_of("0123456789") != slash ||
+            line.find("error:", colon) == std::string::npos)
+            continue;
+        diagnostics[line.substr(0, colon + 2)].push_back(line);
+    }
+
+    for (auto &entry : diagnostics)
+    {
+        const std::string &id = entry.first;
+        size_t             slash = id.find('/');
+        std::string        variant = id.substr(slash + 1, id.size() - slash - 3);
+
+        std::cout << "program " << id.substr(0, slash) << ", "
+                  << (variant == "_primary" ? "primary"
+                                            : "variant " + variant)
+                  << ":" << std::endl;
+        for (auto &diagnostic : entry.second)
+            std::cout << "  " << diagnostic << std::endl;
+    }
+
+    if (result.status != 0 && diagnostics.empty())
+    {
+        std::cout << file << " failed with status " << result.status << ":"
+                  << std::endl
+                  << result.output;
+    }
+    return result.status == 0;
+}
+
+bool
+Validator::run(const ValidateOptions &validate, const std::string &path)
+{
+    Generator                generator;
+    auto                     random = std::make_shared<SeededRandomSource>(_seed);
+    unsigned                 jobs = validate.jobs;
+    std::mutex               mutex;
+    std::condition_variable  ready;
+    std::deque<std::string>  pending;
+    bool                     done = false;
+    size_t                   failed = 0;
+    std::vector<std::thread> workers;
+
+    if (_options.minimizeStrength != 0 && _options.variantLimit == 0)
+    {
+        std::cerr << "Minimizing needs a limit of variants" << std::endl;
+        return false;
+    }
+
+    /* The same sequence of random decisions as the command line takes */
+    random->next();
+    generator.setOptions(_options);
+    generator.setRandomSource(random);
+
+    if (jobs == 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned j = 0; j < jobs; ++j)
+    {
+        workers.emplace_back([&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (true)
+            {
+                ready.wait(lock, [&]() { return done || !pending.empty(); });
+                if (pending.empty())
+                    return;
+
+                std::string file = pending.front();
+                pending.pop_front();
+
+                lock.unlock();
+                ProcessResult result = runCommand(validate.command, file,
+                                                  true);
+                lock.lock();
+
+                /* Reports of several translation units must not interleave */
+                if (report(file, result))
+                    std::remove(file.c_str());
+                else
+                    failed++;
+            }
+        });
+    }
+
+    std::string unit;
+    std::string prelude;
+    size_t      items = 0;
+    size_t      units = 0;
+    unsigned    packed = 0;
+    bool        generated = true;
+
+    /* Translation units are compiled while the next ones are generated */
+    auto flush = [&]() {
+        if (packed == 0)
+            return;
+
+        std::string   file = path + "/validate_" + std::to_string(units++) +
+            ".c";
+        std::ofstream ofs(file, std::ios::binary);
+
+        ofs.write(unit.data(), unit.size());
+        ofs.close();
+        unit.clear();
+        packed = 0;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(file);
+        ready.notify_one();
+    };
+
+    auto pack = [&](const std::shared_ptr<Syntax> &root,
+                    const std::vector<Renamed>    &renamed,
+                    size_t                         program,
+                    long long                      variant) {
+        if (packed == 0)
+            unit.append(prelude);
+        append(root, renamed, program, variant, unit);
+        items++;
+        if (++packed == validate.chunk)
+            flush();
+    };
+
+    for (size_t p = 0; p < _options.programs; ++p)
+    {
+        std::vector<Renamed> renamed;
+        std::shared_ptr<Syntax> root =
+            _options.isLargeProgram()
+                ? generator.generateLargeProgram(_options.targetBytes,
+                                                 _options.targetNodes)
+                : generator.generateProgram();
+
+        if (root == nullptr)
+        {
+            std::cerr << "Failed to load expressions "
+                      << _options.expressionFile << std::endl;
+            generated = false;
+            break;
+        }
+
+        if (!root->children().empty() &&
+            root->children()[0]->getKind() == SyntaxKind::Exact)
+            prelude = root->children()[0]->getStringValue();
+
+        /* Like the files, the primary program belongs to the first shard */
+        collectNames(root, renamed);
+        if (_options.shardIndex == 0)
+            pack(root, renamed, p, -1);
+
+        generator.forEachVariant(
+            root, [&](size_t i) { pack(root, renamed, p, i); });
+    }
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        ready.notify_all();
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    std::cout << "validated " << items << " programs and variants in "
+              << units << " translation units, " << failed << " failed"
+              << std::endl;
+    return generated && failed == 0;
+}
+}
@@ -0,0 +1,512 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "VariantStream.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include "Generator.hpp"
+#include "Serialization.hpp"
+
+namespace FuzzyTest
+{
+VariantStream::VariantStream(Generator                     &generator,
+                             const std::shared_ptr<Syntax> &root,
+                             int                            shift) :
+  _generator(generator)
+{
+    pushNode(root, shift);
+}
+
+VariantStream::VariantStream(Generator                     &generator,
+                             const std::shared_ptr<Syntax> &root,
+                             VariantOrder                   order) :
+  _generator(generator),
+  _order(order)
+{
+    size_t index = 0;
+
+    if (order == VariantOrder::Lexicographic)
+        pushNode(root, 0);
+    else
+        collectDigits(root, true, index);
+}
+
+VariantStream::VariantStream(Generator &generator) : _generator(generator)
+{
+}
+
+VariantStream::VariantStream(Generator                            &generator,
+                             std::vector<std::shared_ptr<Syntax>> &children,
+                             int                                   start,
+                             int                                   end,
+                             int                                   shift) :
+  _generator(generator)
+{
+    pushRange(children, start, end, shift);
+}
+
+bool
+VariantStream::next()
+{
+    if (_order == VariantOrder::GrayCode)
+        return nextGray();
+
+    while (!_stack.empty())
+    {
+        Frame &frame = _stack.back();
+
+        if (frame.next < frame.end)
+        {
+            int shift = frame.shift + 1;
+
+            /* The frame reference is invalidated by the push */
+            pushNode((*frame.children)[frame.next++], shift);
+            continue;
+        }
+
+        if (!frame.permuted)
+        {
+            _stack.pop_back();
+            continue;
+        }
+
+        int shift = frame.shift;
+
+        if (std::next_permutation(
+                frame.children->begin() + frame.start,
+                frame.children->begin() + frame.end,
+                [this, shift](const std::shared_ptr<Syntax> &a,
+                              const std::shared_ptr<Syntax> &b) {
+                    return getKey(shift, a.get()) < getKey(shift, b.get());
+                }))
+        {
+            /* Children are permuted further on the next call */
+            frame.next = frame.start;
+            _count++;
+            return true;
+        }
+        _stack.pop_back();
+    }
+    return false;
+}
+
+int
+VariantStream::getRangeStart(SyntaxKind kind)
+{
+    switch (kind)
+    {
+        case SyntaxKind::IfGroup:
+        case SyntaxKind::Switch:
+        case SyntaxKind::For:
+        case SyntaxKind::While:
+        {
+            return Generator::getPermutationStart(kind);
+        }
+        case SyntaxKind::Type:
+        case SyntaxKind::Identifier:
+        case SyntaxKind::Literal:
+        case SyntaxKind::Exact:
+        case SyntaxKind::Declaration:
+        case SyntaxKind::FunctionProto:
+        case SyntaxKind::Return:
+        case SyntaxKind::Assign:
+        case SyntaxKind::Binary:
+        case SyntaxKind::Break:
+        case SyntaxKind::Assert:
+        case SyntaxKind::Nop:
+        case SyntaxKind::Call:
+        {
+            return -2;
+        }
+        default:
+        {
+            return -1;
+        }
+    }
+}
+
+void
+VariantStream::pushNode(const std::shared_ptr<Syntax> &node, int shift)
+{
+    auto &children = node->children();
+    int   start = getRangeStart(node->getKind());
+
+    if (children.size() == 0 || start == -2)
+        return;
+
+    if (start >= 0)
+    {
+        pushRange(children, start, children.size(), shift + 1);
+        return;
+    }
+
+    _stack.push_back({ &children, 0, static_cast<int>(children.size()),
+                       shift, 0, false });
+}
+
+/**
+ * @brief      Count permutations of the children range
+ *
+ * @param      size  The size of the range
+ *
+ * @return     The factorial of the size, @c 0 if it does not fit, so that
+ *             the digit never wraps around
+ */
+static uint64_t
+countPermutations(int size)
+{
+    uint64_t count = 1;
+
+    for (int i = 2; i <= size; ++i)
+    {
+        if (count > UINT64_MAX / i)
+            return 0;
+        count *= i;
+    }
+    return count;
+}
+
+void
+VariantStream::collectDigits(const std::shared_ptr<Syntax> &node,
+                             bool                           visited,
+                             size_t                        &index)
+{
+    int start;
+
+    if (node == nullptr)
+        return;
+
+    auto &children = node->children();
+    int   size = static_cast<int>(children.size());
+
+    start = visited ? getRangeStart(node->getKind()) : -2;
+    if (start >= 0 && size - start >= 2)
+    {
+        Digit digit = { &children, index, start, size - start,
+                        countPermutations(size - start), 0, {}, {} };
+
+        resetDigit(digit);
+        _digits.push_back(std::move(digit));
+    }
+
+    index++;
+    for (int i = 0; i < size; ++i)
+    {
+        collectDigits(children[i], start == -1 || (start >= 0 && i >= start),
+                      index);
+    }
+}
+
+void
+VariantStream::resetDigit(Digit &digit)
+{
+    digit.offsets.assign(digit.size + 1, 0);
+    digit.directions.assign(digit.size + 1, 1);
+}
+
+void
+VariantStream::stepDigit(Digit &digit)
+{
+    auto &children = *digit.children;
+    int   j = digit.size;
+    int   s = 0;
+
+    _swapNode = digit.node;
+
+    /* Algorithm P of Knuth (plain changes) */
+    while (j > 1 || digit.offsets[j] + digit.directions[j] != j)
+    {
+        int q = digit.offsets[j] + digit.directions[j];
+
+        if (q == j)
+        {
+            s++;
+        }
+        else if (q >= 0)
+        {
+            int x = j - digit.offsets[j] + s;
+            int y = j - q + s;
+
+            std::swap(children[digit.start + x - 1],
+                      children[digit.start + y - 1]);
+            digit.offsets[j] = q;
+            _swapPosition = digit.start + std::min(x, y) - 1;
+            return;
+        }
+        digit.directions[j] = -digit.directions[j];
+        j--;
+    }
+
+    /* The last permutation differs from the first one by the first swap */
+    std::swap(children[digit.start], children[digit.start + 1]);
+    resetDigit(digit);
+    _swapPosition = digit.start;
+}
+
+bool
+VariantStream::nextGray()
+{
+    size_t i = _digits.size();
+
+    /*
+     * The counter is incremented as usual, but only the digit that is
+     * incremented changes in the modular Gray code, digits that wrap around
+     * keep their permutation.
+     */
+    while (i > 0 && _digits[i - 1].radix != 0 &&
+           _digits[i - 1].position == _digits[i - 1].radix - 1)
+        i--;
+
+    if (i == 0)
+        return false;
+
+    for (size_t j = i; j < _digits.size(); ++j)
+        _digits[j].position = 0;
+
+    _digits[i - 1].position++;
+    stepDigit(_digits[i - 1]);
+    _count++;
+    return true;
+}
+
+bool
+VariantStream::lastSwap(size_t &node, size_t &position) const
+{
+    if (_order != VariantOrder::GrayCode || _count == 0)
+        return false;
+
+    node = _swapNode;
+    position = _swapPosition;
+    return true;
+}
+
+void
+VariantStream::pushRange(std::vector<std::shared_ptr<Syntax>> &children,
+                         int                                   start,
+                         int                                   end,
+                         int                                   shift)
+{
+    int count = 0;
+
+    /* An empty range has always stopped the whole permutation */
+    if (end - start == 0)
+    {
+        _stack.clear();
+        _stopped = true;
+        return;
+    }
+
+    if (_keys.size() <= static_cast<size_t>(shift))
+        _keys.resize(shift + 1);
+    _keys[shift].clear();
+
+    for (auto &ch : children)
+    {
+        /* This weird condition accelerates changes */
+        setKey(shift, ch.get(),
+               (_generator.random(50) < 30) ? count : count++);
+    }
+
+    _stack.push_back({ &children, start, end, shift, end, true });
+}
+
+void
+VariantStream::setKey(int shift, const Syntax *node, int key)
+{
+    for (auto &entry : _keys[shift])
+    {
+        if (entry.first == node)
+        {
+            entry.second = key;
+            return;
+        }
+    }
+    _keys[shift].emplace_back(node, key);
+}
+
+int
+VariantStream::getKey(int shift, const Syntax *node) const
+{
+    for (auto &entry : _keys[shift])
+    {
+        if (entry.first == node)
+            return entry.second;
+    }
+    return 0;
+}
+
+void
+VariantStream::saveState(std::string                 &out,
+                         const std::vector<Syntax *> &nodes) const
+{
+    std::unordered_map<const void *, uint64_t> ids;
+
+    /* Frames keep children vectors, so both are mapped to the node index */
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        ids.emplace(nodes[i], i);
+        ids.emplace(&nodes[i]->children(), i);
+    }
+
+    putVarint(out, _count);
+    putVarint(out, _stopped ? 1 : 0);
+
+    putVarint(out, _stack.size());
+    for (auto &frame : _stack)
+    {
+        putVarint(out, ids.at(frame.children));
+        putVarint(out, frame.start);
+        putVarint(out, frame.end);
+        putVarint(out, frame.shift);
+        putVarint(out, frame.next);
+        putVarint(out, frame.permuted ? 1 : 0);
+    }
+
+    putVarint(out, _keys.size());
+    for (auto &keys : _keys)
+    {
+        putVarint(out, keys.size());
+        for (auto &entry : keys)
+        {
+            putVarint(out, ids.at(entry.first));
+            putVarint(out, entry.second);
+        }
+    }
+
+    putVarint(out, static_cast<uint64_t>(_order));
+    putVarint(out, _swapNode);
+    putVarint(out, _swapPosition);
+    putVarint(out, _digits.size());
+    for (auto &digit : _digits)
+    {
+        putVarint(out, ids.at(digit.children));
+        putVarint(out, digit.start);
+        putVarint(out, digit.position);
+        for (int j = 1; j <= digit.size; ++j)
+        {
+            putVarint(out, digit.offsets[j]);
+            putVarint(out, digit.directions[j] > 0 ? 1 : 0);
+        }
+    }
+}
+
+bool
+VariantStream::restoreState(const char                *&pos,
+                            const char                 *end,
+                            const std::vector<Syntax *> &nodes)
+{
+    uint64_t count;
+    uint64_t stopped;
+    uint64_t size;
+    uint64_t values[6];
+
+    if (!getVarint(pos, end, count) || !getVarint(pos, end, stopped) ||
+        !getVarint(pos, end, size))
+        return false;
+
+    _stack.clear();
+    _keys.clear();
+    _count = count;
+    _stopped = stopped != 0;
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        for (auto &value : values)
+        {
+            if (!getVarint(pos, end, value))
+                return false;
+        }
+
+        if (values[0] >= nodes.size())
+            return false;
+
+        auto &children = nodes[values[0]]->children();
+
+        if (values[2] > children.size() || values[1] > values[2] ||
+            values[4] > values[2] || values[3] > 0x7FFFFFFF)
+            return false;
+
+        _stack.push_back({ &children, static_cast<int>(values[1]),
+                           static_cast<int>(values[2]),
+                           static_cast<int>(values[3]),
+                           static_cast<int>(values[4]), values[5] != 0 });
+    }
+
+    if (!getVarint(pos, end, size) || size > 0x7FFFFFFF)
+        return false;
+
+    _keys.resize(size);
+    for (auto &keys : _keys)
+    {
+        if (!getVarint(pos, end, size))
+            return false;
+
+        for (uint64_t i = 0; i < size; ++i)
+        {
+            if (!getVarint(pos, end, values[0]) ||
+                !getVarint(pos, end, values[1]) ||
+                values[0] >= nodes.size())
+                return false;
+            keys.emplace_back(nodes[values[0]],
+                              static_cast<int>(values[1]));
+        }
+    }
+
+    if (!getVarint(pos, end, values[0]) ||
+        values[0] > static_cast<uint64_t>(VariantOrder::GrayCode) ||
+        !getVarint(pos, end, values[1]) || !getVarint(pos, end, values[2]) ||
+        !getVarint(pos, end, size))
+        return false;
+
+    _order = static_cast<VariantOrder>(values[0]);
+    _swapNode = values[1];
+    _swapPosition = values[2];
+    _digits.clear();
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        if (!getVarint(pos, end, values[0]) ||
+            !getVarint(pos, end, values[1]) ||
+            !getVarint(pos, end, values[2]) || values[0] >= nodes.size() ||
+            values[1] + 2 > nodes[values[0]]->children().size())
+            return false;
+
+        auto &children = nodes[values[0]]->children();
+        int   length = static_cast<int>(children.size() - values[1]);
+        Digit digit = { &children, values[0], static_cast<int>(values[1]),
+                        length, countPermutations(length), values[2], {}, {} };
+
+        if (digit.radix != 0 && digit.position >= digit.radix)
+            return false;
+
+        resetDigit(digit);
+        for (int j = 1; j <= digit.size; ++j)
+        {
+            if (!getVarint(pos, end, values[0]) ||
+                !getVarint(pos, end, values[1]) ||
+                values[0] > static_cast<uint64_t>(j))
+                return false;
+            digit.offsets[j] = static_cast<int>(values[0]);
+            digit.directions[j] = values[1] != 0 ? 1 : -1;
+        }
+        _digits.push_back(std::move(digit));
+    }
+    return true;
+}
+
+void
+VariantStream::collectNodes(const std::shared_ptr<Syntax> &root,
+                            std::vector<Syntax *>         &nodes)
+{
+    if (root == nullptr)
+        return;
+
+    nodes.push_back(root.get());
+    for (auto &ch : root->children())
+    {
+        collectNodes(ch, nodes);
+    }
+}
+}
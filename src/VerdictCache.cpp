@@ -0,0 +1,122 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include "VerdictCache.hpp"
+#include <cstring>
+#include <unistd.h>
+
+namespace FuzzyTest
+{
+static const char   cacheMagic[] = { 'F', 'Z', 'V' };
+/* Version 2 keeps the type of literals in the canonical form */
+static const uint8_t cacheVersion = 2;
+static const size_t recordSize = 20;
+
+static void
+putBytes(unsigned char *out, uint64_t value, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        out[i] = static_cast<unsigned char>(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+static uint64_t
+getBytes(const unsigned char *in, int count)
+{
+    uint64_t value = 0;
+
+    for (int i = count - 1; i >= 0; --i)
+        value = (value << 8) | in[i];
+    return value;
+}
+
+VerdictCache::~VerdictCache()
+{
+    if (_file != nullptr)
+        std::fclose(_file);
+}
+
+bool
+VerdictCache::open(const std::string &file)
+{
+    unsigned char header[sizeof(cacheMagic) + 1];
+    unsigned char record[recordSize];
+    long          valid;
+
+    if (_file != nullptr)
+        std::fclose(_file);
+    _verdicts.clear();
+
+    _file = std::fopen(file.c_str(), "r+b");
+    if (_file == nullptr)
+    {
+        _file = std::fopen(file.c_str(), "w+b");
+        if (_file == nullptr)
+            return false;
+
+        std::memcpy(header, cacheMagic, sizeof(cacheMagic));
+        header[sizeof(cacheMagic)] = cacheVersion;
+        return std::fwrite(header, sizeof(header), 1, _file) == 1 &&
+            std::fflush(_file) == 0;
+    }
+
+    if (std::fread(header, sizeof(header), 1, _file) != 1 ||
+        std::memcmp(header, cacheMagic, sizeof(cacheMagic)) != 0 ||
+        header[sizeof(cacheMagic)] != cacheVersion)
+    {
+        std::fclose(_file);
+        _file = nullptr;
+        return false;
+    }
+
+    valid = sizeof(header);
+    while (std::fread(record, sizeof(record), 1, _file) == 1)
+    {
+        TreeHash hash;
+
+        hash.low = getBytes(record, 8);
+        hash.high = getBytes(record + 8, 8);
+        _verdicts[hash] = static_cast<int32_t>(getBytes(record + 16, 4));
+        valid += sizeof(record);
+    }
+
+    /* A torn record left by a killed run is dropped */
+    std::fflush(_file);
+    if (ftruncate(fileno(_file), valid) != 0)
+        return false;
+    return std::fseek(_file, valid, SEEK_SET) == 0;
+}
+
+bool
+VerdictCache::find(const TreeHash &hash, int &status) const
+{
+    auto it = _verdicts.find(hash);
+
+    if (it == _verdicts.end())
+        return false;
+
+    status = it->second;
+    return true;
+}
+
+bool
+VerdictCache::insert(const TreeHash &hash, int status)
+{
+    unsigned char record[recordSize];
+
+    _verdicts[hash] = status;
+    if (_file == nullptr)
+        return false;
+
+    putBytes(record, hash.low, 8);
+    putBytes(record + 8, hash.high, 8);
+    putBytes(record + 16, static_cast<uint32_t>(status), 4);
+
+    /* Every verdict is written through, it took an analyzer run to get */
+    return std::fwrite(record, sizeof(record), 1, _file) == 1 &&
+        std::fflush(_file) == 0;
+}
+}
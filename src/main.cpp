@@ -3,9 +3,16 @@
  * (C) Maxim Menshikov 2019-2020
  */
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iostream>
+#include "Analysis.hpp"
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
 #include "Generator.hpp"
+#include "Search.hpp"
+#include "Server.hpp"
+#include "Validator.hpp"
 
 using namespace FuzzyTest;
 
@@ -15,22 +22,737 @@ using namespace FuzzyTest;
 #define SEED (std::time(0))
 #endif
 
+static void
+usage(const char *name)
+{
+    std::cerr << "Usage: " << std::string(name) << " [options] path"
+              << std::endl
+              << "Options:" << std::endl
+              << "  --seed N       seed of the random generator" << std::endl
+              << "  --variants N   maximum number of variants, 0 for no limit"
+              << std::endl
+              << "  --shard I/N    emit only the I-th of N slices of variants"
+              << std::endl
+              << "  --corpus       store variants as a delta-encoded corpus"
+              << std::endl
+              << "  --gray-order   change variants by one adjacent swap, listed"
+              << std::endl
+              << "                 in swaps.csv" << std::endl
+              << "  --minimize     keep only variants needed to cover every"
+              << std::endl
+              << "                 ordering of adjacent children" << std::endl
+              << "  --minimize-strength N" << std::endl
+              << "                 cover orderings of N consecutive children"
+              << std::endl
+              << "  --expand FILE  expand the corpus FILE into C files"
+              << std::endl
+              << "  --variant N    expand only the variant N of the corpus"
+              << std::endl
+              << "  --save-ast     save the binary tree as _primary.ast"
+              << std::endl
+              << "  --load-ast FILE" << std::endl
+              << "                 permute the binary tree FILE instead of a"
+              << std::endl
+              << "                 generated one" << std::endl
+              << "  --target-bytes N[k|m|g]" << std::endl
+              << "                 generate a multi-function program of N bytes"
+              << std::endl
+              << "  --target-nodes N[k|m|g]" << std::endl
+              << "                 generate a multi-function program of N nodes"
+              << std::endl
+              << "  --render-threads N" << std::endl
+              << "                 threads rendering large programs, 0 for one"
+              << std::endl
+              << "                 per CPU" << std::endl
+              << "  --obfuscation-depth N" << std::endl
+              << "                 apply exactly N obfuscation steps to the goal"
+              << std::endl
+              << "  --obfuscation-branch N" << std::endl
+              << "                 use only the obfuscation branch N (1-6)"
+              << std::endl
+              << "  --switch-cases N" << std::endl
+              << "                 generate N secondary cases in goal switches"
+              << std::endl
+              << "  --if-branches N" << std::endl
+              << "                 generate N else branches in goal if groups"
+              << std::endl
+              << "  --sweep CMD    run CMD on programs of growing size, {} in"
+              << std::endl
+              << "                 CMD is replaced with the program file"
+              << std::endl
+              << "  --sweep-steps N, --sweep-factor F, --sweep-repeat N"
+              << std::endl
+              << "                 number of sizes, ratio between sizes and"
+              << std::endl
+              << "                 number of analyzer runs for each size"
+              << std::endl
+              << "  --branch-weights W1,...,W6" << std::endl
+              << "                 relative weights of obfuscation branches"
+              << std::endl
+              << "  --literal-percent N" << std::endl
+              << "                 percentage (50-100) of plain literal values"
+              << std::endl
+              << "  --goals N      check N independent goals in every program"
+              << std::endl
+              << "                 and list the asserts in asserts.csv"
+              << std::endl
+              << "  --goal-functions N" << std::endl
+              << "                 spread the goals across N functions"
+              << std::endl
+              << "  --expressions N" << std::endl
+              << "                 instantiate opaque expressions from N"
+              << std::endl
+              << "                 precomputed templates of every kind"
+              << std::endl
+              << "  --expressions-file FILE" << std::endl
+              << "                 load the templates from FILE, or save them"
+              << std::endl
+              << "                 into it if it doesn't exist" << std::endl
+              << "  --search CMD   search for programs CMD is slowest on"
+              << std::endl
+              << "  --search-population N, --search-generations N,"
+              << std::endl
+              << "  --search-repeat N" << std::endl
+              << "                 size of the population, number of"
+              << std::endl
+              << "                 generations of the search and number of"
+              << std::endl
+              << "                 analyzer runs for each program" << std::endl
+              << "  --programs N   generate N programs into numbered folders"
+              << std::endl
+              << "  --checkpoint FILE" << std::endl
+              << "                 save the state of the run to FILE and resume"
+              << std::endl
+              << "                 from it when started again" << std::endl
+              << "  --checkpoint-interval N" << std::endl
+              << "                 number of variants between checkpoints"
+              << std::endl
+              << "  --serve ADDR   serve programs on the Unix socket ADDR, or on"
+              << std::endl
+              << "                 the loopback TCP port if ADDR is PORT or"
+              << std::endl
+              << "                 localhost:PORT, PORT is 1-65535"
+              << std::endl
+              << "  --serve-prefetch N" << std::endl
+              << "                 number of items prefetched for each client"
+              << std::endl
+              << "  --validate     compile the programs and variants, many of"
+              << std::endl
+              << "                 them packed into one translation unit"
+              << std::endl
+              << "  --validate-command CMD" << std::endl
+              << "                 compiler command, cc -fsyntax-only by default"
+              << std::endl
+              << "  --validate-chunk N, --validate-jobs N" << std::endl
+              << "                 programs per translation unit and number of"
+              << std::endl
+              << "                 compilers run in parallel" << std::endl
+              << "  --analyze CMD  run CMD on the programs and variants unless"
+              << std::endl
+              << "                 a program equal up to renaming was already"
+              << std::endl
+              << "                 analyzed" << std::endl
+              << "  --analyze-cache FILE" << std::endl
+              << "                 verdict cache, verdicts.fzv in the output"
+              << std::endl
+              << "                 folder by default" << std::endl
+              << "  --perf-counters" << std::endl
+              << "                 report hardware performance counters of"
+              << std::endl
+              << "                 every pipeline stage" << std::endl
+              << "  --count-allocations" << std::endl
+              << "                 report heap allocations per program and"
+              << std::endl
+              << "                 per variant" << std::endl;
+}
+
+static bool
+parseNumber(const char *str, unsigned long long &value)
+{
+    char *end;
+
+    if (str == nullptr || *str == '\0')
+        return false;
+
+    value = std::strtoull(str, &end, 0);
+    return *end == '\0';
+}
+
+static bool
+parseSize(const char *str, unsigned long long &value)
+{
+    char *end;
+
+    if (str == nullptr || *str == '\0')
+        return false;
+
+    value = std::strtoull(str, &end, 0);
+    switch (*end)
+    {
+        case 'g':
+        case 'G':
+            value *= 1024;
+            /* fallthrough */
+        case 'm':
+        case 'M':
+            value *= 1024;
+            /* fallthrough */
+        case 'k':
+        case 'K':
+            value *= 1024;
+            ++end;
+            break;
+        default:
+            break;
+    }
+    return *end == '\0';
+}
+
+static bool
+parseWeights(const char *str, Options &options)
+{
+    char *end;
+
+    if (str == nullptr)
+        return false;
+
+    for (size_t i = 0; i < options.branchWeights.size(); ++i)
+    {
+        unsigned long weight = std::strtoul(str, &end, 10);
+
+        if (end == str || weight > 0xFFFF)
+            return false;
+        options.branchWeights[i] = weight;
+
+        if (i + 1 == options.branchWeights.size())
+            return *end == '\0';
+        if (*end != ',' && *end != ':')
+            return false;
+        str = end + 1;
+    }
+    return false;
+}
+
+static bool
+parseShard(const char *str, Options &options)
+{
+    unsigned long long index;
+    unsigned long long count;
+    char              *end;
+
+    if (str == nullptr)
+        return false;
+
+    index = std::strtoull(str, &end, 10);
+    if (end == str || *end != '/')
+        return false;
+
+    str = end + 1;
+    count = std::strtoull(str, &end, 10);
+    if (end == str || *end != '\0' || count == 0 || index >= count)
+        return false;
+
+    options.shardIndex = index;
+    options.shardCount = count;
+    return true;
+}
+
+static bool
+parseServeAddress(const char *str, ServerOptions &server)
+{
+    unsigned long long port;
+    const char        *digits = str;
+
+    if (str == nullptr)
+        return false;
+
+    server.address = str;
+    if (std::strncmp(digits, "localhost:", 10) == 0)
+        digits += 10;
+
+    /* Anything but a number is the path of the Unix domain socket */
+    if (*digits == '\0' ||
+        std::strspn(digits, "0123456789") != std::strlen(digits))
+        return true;
+
+    if (!parseNumber(digits, port) || port == 0 || port > 0xFFFF)
+        return false;
+    server.port = port;
+    return true;
+}
+
 int
 main(int argc, const char *argv[])
 {
-    int       rand;
-    Generator generator;
+    Generator          generator;
+    Options            options;
+    unsigned long long seed = SEED;
+    unsigned long long value;
+    const char        *path = nullptr;
+    const char        *expandFile = nullptr;
+    long long          variant = -1;
+    SweepOptions       sweep;
+    SearchOptions      search;
+    ServerOptions      server;
+    ValidateOptions    validate;
+    bool               validating = false;
+    AnalyzeOptions     analyze;
 
-    if (argc != 2)
+    for (int i = 1; i < argc; ++i)
     {
-        std::cerr << "Usage: " << std::string(argv[0]) << " path" << std::endl;
+        const char *arg = argv[i];
+        const char *param = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (std::strcmp(arg, "--seed") == 0)
+        {
+            if (!parseNumber(param, seed))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            ++i;
+        }
+        else if (std::strcmp(arg, "--variants") == 0)
+        {
+            if (!parseNumber(param, value))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.variantLimit = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--shard") == 0)
+        {
+            if (!parseShard(param, options))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            ++i;
+        }
+        else if (std::strcmp(arg, "--corpus") == 0)
+        {
+            options.corpus = true;
+        }
+        else if (std::strcmp(arg, "--gray-order") == 0)
+        {
+            options.variantOrder = VariantOrder::GrayCode;
+        }
+        else if (std::strcmp(arg, "--minimize") == 0)
+        {
+            options.minimizeStrength = 2;
+        }
+        else if (std::strcmp(arg, "--minimize-strength") == 0)
+        {
+            if (!parseNumber(param, value) || value < 2 || value > 16)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.minimizeStrength = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--save-ast") == 0)
+        {
+            options.saveAst = true;
+        }
+        else if (std::strcmp(arg, "--load-ast") == 0)
+        {
+            if (param == nullptr)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.astFile = param;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--expand") == 0)
+        {
+            if (param == nullptr)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            expandFile = param;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--variant") == 0)
+        {
+            if (!parseNumber(param, value))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            variant = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--target-bytes") == 0)
+        {
+            if (!parseSize(param, value))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.targetBytes = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--target-nodes") == 0)
+        {
+            if (!parseSize(param, value))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.targetNodes = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--render-threads") == 0)
+        {
+            if (!parseNumber(param, value) || value > 0xFFFF)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.renderThreads = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--obfuscation-depth") == 0 ||
+                 std::strcmp(arg, "--obfuscation-branch") == 0 ||
+                 std::strcmp(arg, "--switch-cases") == 0 ||
+                 std::strcmp(arg, "--if-branches") == 0)
+        {
+            bool branch = std::strcmp(arg, "--obfuscation-branch") == 0;
+
+            if (!parseNumber(param, value) || value > 0x7FFFFFFF ||
+                (branch && (value < 1 || value > 6)))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            if (std::strcmp(arg, "--obfuscation-depth") == 0)
+                options.obfuscationDepth = value;
+            else if (branch)
+                options.obfuscationBranch = value;
+            else if (std::strcmp(arg, "--switch-cases") == 0)
+                options.switchCases = value;
+            else
+                options.ifGroupLength = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--sweep") == 0)
+        {
+            if (param == nullptr)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            sweep.command = param;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--sweep-steps") == 0 ||
+                 std::strcmp(arg, "--sweep-repeat") == 0)
+        {
+            if (!parseNumber(param, value) || value == 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            if (std::strcmp(arg, "--sweep-steps") == 0)
+                sweep.steps = value;
+            else
+                sweep.repeat = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--sweep-factor") == 0)
+        {
+            char *end;
+
+            if (param == nullptr ||
+                (sweep.factor = std::strtod(param, &end)) <= 1.0 ||
+                *end != '\0')
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            ++i;
+        }
+        else if (std::strcmp(arg, "--branch-weights") == 0)
+        {
+            if (!parseWeights(param, options))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            ++i;
+        }
+        else if (std::strcmp(arg, "--literal-percent") == 0)
+        {
+            if (!parseNumber(param, value) || value < 50 || value > 100)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.literalPercent = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--goals") == 0 ||
+                 std::strcmp(arg, "--goal-functions") == 0)
+        {
+            if (!parseNumber(param, value) || value == 0 || value > 100000)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            if (std::strcmp(arg, "--goals") == 0)
+                options.goals = value;
+            else
+                options.goalFunctions = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--expressions") == 0)
+        {
+            if (!parseNumber(param, value) || value == 0 || value > 1000000)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.expressions = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--expressions-file") == 0)
+        {
+            if (param == nullptr)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.expressionFile = param;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--search") == 0)
+        {
+            if (param == nullptr)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            search.command = param;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--search-population") == 0 ||
+                 std::strcmp(arg, "--search-generations") == 0 ||
+                 std::strcmp(arg, "--search-repeat") == 0)
+        {
+            if (!parseNumber(param, value) || value == 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            if (std::strcmp(arg, "--search-population") == 0)
+                search.population = value;
+            else if (std::strcmp(arg, "--search-generations") == 0)
+                search.generations = value;
+            else
+                search.repeat = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--programs") == 0 ||
+                 std::strcmp(arg, "--checkpoint-interval") == 0)
+        {
+            if (!parseNumber(param, value) || value == 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            if (std::strcmp(arg, "--programs") == 0)
+                options.programs = value;
+            else
+                options.checkpointInterval = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--checkpoint") == 0)
+        {
+            if (param == nullptr)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.checkpointFile = param;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--serve") == 0)
+        {
+            if (!parseServeAddress(param, server))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            ++i;
+        }
+        else if (std::strcmp(arg, "--serve-prefetch") == 0)
+        {
+            if (!parseNumber(param, value) || value == 0 || value > 0xFFFF)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            server.prefetch = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--validate") == 0)
+        {
+            validating = true;
+        }
+        else if (std::strcmp(arg, "--validate-command") == 0)
+        {
+            if (param == nullptr)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            validate.command = param;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--validate-chunk") == 0 ||
+                 std::strcmp(arg, "--validate-jobs") == 0)
+        {
+            if (!parseNumber(param, value) || value == 0 || value > 0xFFFF)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            if (std::strcmp(arg, "--validate-chunk") == 0)
+                validate.chunk = value;
+            else
+                validate.jobs = value;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--analyze") == 0 ||
+                 std::strcmp(arg, "--analyze-cache") == 0)
+        {
+            if (param == nullptr)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            if (std::strcmp(arg, "--analyze") == 0)
+                analyze.command = param;
+            else
+                analyze.cache = param;
+            ++i;
+        }
+        else if (std::strcmp(arg, "--perf-counters") == 0)
+        {
+            options.perfCounters = true;
+        }
+        else if (std::strcmp(arg, "--count-allocations") == 0)
+        {
+            options.countAllocations = true;
+        }
+        else if (path == nullptr && arg[0] != '-')
+        {
+            path = arg;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    /* Every mode generates programs, so a bad library fails early */
+    generator.setOptions(options);
+    if (!generator.prepareExpressions())
+    {
+        std::cerr << "Failed to load expressions " << options.expressionFile
+                  << std::endl;
+        return 1;
+    }
+
+    if (!server.address.empty())
+    {
+        Server generatorServer(options, seed);
+
+        /* Items are pulled one at a time, nothing selects them afterwards */
+        if (options.minimizeStrength != 0 || options.shardCount != 1)
+        {
+            std::cerr << "Serving doesn't minimize or shard variants"
+                      << std::endl;
+            return 1;
+        }
+
+        generatorServer.run(server);
+        std::cerr << "Failed to listen on " << server.address << std::endl;
         return 1;
     }
 
-    std::srand(SEED);
+    if (path == nullptr)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (expandFile != nullptr)
+    {
+        if (!Corpus::expand(expandFile, path, variant))
+        {
+            std::cerr << "Failed to expand corpus " << expandFile
+                      << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!sweep.command.empty())
+    {
+        Benchmark benchmark(options, seed);
+
+        if (!benchmark.sweep(sweep, path))
+        {
+            std::cerr << "Failed to write sweep results to " << path
+                      << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!search.command.empty())
+    {
+        Search adversarial(options, seed);
+
+        if (!adversarial.run(search, path))
+        {
+            std::cerr << "Failed to write search results to " << path
+                      << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (validating)
+    {
+        Validator validator(options, seed);
+
+        return validator.run(validate, path) ? 0 : 1;
+    }
+
+    if (!analyze.command.empty())
+    {
+        Analysis analysis(options, seed);
+
+        return analysis.run(analyze, path) ? 0 : 1;
+    }
+
+    /* The random state is owned by the generator, so it can be saved */
+    auto random = std::make_shared<SeededRandomSource>(seed);
+
     /* Just get the gears rolling */
-    std::rand();
+    random->next();
 
-    generator.generateTestScript(std::string(argv[1]));
+    generator.setOptions(options);
+    generator.setRandomSource(random);
+    if (!generator.generateTestScript(std::string(path)))
+        return 1;
     return 0;
-}
\ No newline at end of file
+}
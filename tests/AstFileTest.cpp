@@ -0,0 +1,214 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <string>
+#include "AstFile.hpp"
+#include "Check.hpp"
+
+using namespace FuzzyTest;
+
+/* Seeds whose programs have variants with the default options */
+static const unsigned seeds[] = { 8, 11, 53 };
+
+/* Size of the header and offsets of its fields */
+static const size_t headerSize = 40;
+static const size_t widthsAt = 8;
+static const size_t stringsAt = 16;
+
+/**
+ * @brief      Check that the node of the file is the same as the syntax node
+ */
+static void
+checkNode(const AstFile                 &file,
+          uint32_t                       node,
+          const std::shared_ptr<Syntax> &ref)
+{
+    size_t length;
+
+    CHECK(node < file.nodeCount());
+    if (node >= file.nodeCount())
+        return;
+
+    const char *value = file.value(node, length);
+
+    CHECK(file.kind(node) == ref->getKind());
+    CHECK(std::string(value, length) == ref->getStringValue());
+    CHECK(file.childCount(node) == ref->children().size());
+    if (file.childCount(node) != ref->children().size())
+        return;
+
+    for (uint32_t i = 0; i < file.childCount(node); ++i)
+    {
+        auto &ch = ref->children()[i];
+
+        if (ch == nullptr)
+            CHECK(file.child(node, i) == AstFile::none);
+        else
+            checkNode(file, file.child(node, i), ch);
+    }
+}
+
+static void
+testRoundTrip(const std::shared_ptr<Syntax> &root)
+{
+    std::string data;
+    std::string state = "random state";
+    AstFile     file;
+    size_t      length;
+
+    AstFile::encode(root, data, state);
+    CHECK(data.size() % 4 == 0);
+    CHECK(file.open(data.data(), data.size()));
+    CHECK(file.root() == 0);
+    checkNode(file, file.root(), root);
+
+    const char *saved = file.randomState(length);
+
+    CHECK(saved != nullptr && std::string(saved, length) == state);
+
+    auto loaded = file.load();
+
+    CHECK(loaded != nullptr && loaded->toString() == root->toString());
+
+    /* Files without a random state leave the order to the seed */
+    data.clear();
+    AstFile::encode(root, data);
+    CHECK(file.open(data.data(), data.size()));
+    CHECK(file.randomState(length) == nullptr && length == 0);
+}
+
+static void
+testEmpty()
+{
+    std::string data;
+    AstFile     file;
+
+    AstFile::encode(nullptr, data);
+    CHECK(file.open(data.data(), data.size()));
+    CHECK(file.root() == AstFile::none);
+    CHECK(file.nodeCount() == 0);
+    CHECK(file.load() == nullptr);
+}
+
+/**
+ * @brief      Check that the file can't be opened
+ */
+static void
+checkRejected(const std::string &data)
+{
+    AstFile file;
+
+    CHECK(!file.open(data.data(), data.size()));
+    CHECK(file.load() == nullptr);
+}
+
+static void
+testMalformed(const std::shared_ptr<Syntax> &root)
+{
+    std::string data;
+    AstFile     file;
+
+    AstFile::encode(root, data, "state");
+
+    /*
+     * Truncations past the alignment padding are rejected, large files are
+     * cut at a few thousand points only
+     */
+    size_t step = 1 + data.size() / 4096;
+
+    for (size_t size = 0; size + 3 < data.size(); size += step)
+        checkRejected(data.substr(0, size));
+    checkRejected(data.substr(0, data.size() - 4));
+
+    CHECK(file.open(data.data(), data.size()));
+
+    unsigned offsetWidth = data[widthsAt];
+    unsigned valueWidth = data[widthsAt + 1];
+    unsigned childWidth = data[widthsAt + 2];
+    unsigned nodeWidth = data[widthsAt + 3];
+    uint32_t strings = 0;
+
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        strings |= static_cast<uint32_t>(
+                       static_cast<uint8_t>(data[stringsAt + i]))
+                   << (8 * i);
+    }
+
+    size_t nodesAt = headerSize + offsetWidth * (strings + 1);
+    size_t nodeSize = 1 + valueWidth + childWidth;
+    size_t childrenAt = nodesAt + nodeSize * file.nodeCount();
+
+    CHECK(file.childCount(file.root()) > 0);
+
+    std::string bad = data;
+
+    bad[4]++;
+    checkRejected(bad);
+
+    for (char width : { 0, 5 })
+    {
+        bad = data;
+        bad[widthsAt + 3] = width;
+        checkRejected(bad);
+    }
+
+    /* A kind unknown to the generator */
+    bad = data;
+    bad[nodesAt] = static_cast<char>(0xFF);
+    checkRejected(bad);
+
+    /* A value outside of the strings */
+    bad = data;
+    bad.replace(nodesAt + 1, valueWidth, valueWidth, static_cast<char>(0xFF));
+    if (strings < (1ULL << (8 * valueWidth)) - 1)
+        checkRejected(bad);
+
+    /* Children of the second node start past the end of the list */
+    bad = data;
+    bad.replace(nodesAt + nodeSize + 1 + valueWidth, childWidth, childWidth,
+                static_cast<char>(0xFF));
+    checkRejected(bad);
+
+    /* The first child of the root is the root itself */
+    bad = data;
+    bad.replace(childrenAt, nodeWidth, nodeWidth, '\0');
+    checkRejected(bad);
+
+    /* A child outside of the nodes */
+    bad = data;
+    bad.replace(childrenAt, nodeWidth, nodeWidth, static_cast<char>(0xFF));
+    bad[childrenAt] = static_cast<char>(0xFE);
+    if (file.nodeCount() < (1ULL << (8 * nodeWidth)) - 2)
+        checkRejected(bad);
+}
+
+int
+main()
+{
+    for (auto seed : seeds)
+    {
+        Generator generator;
+
+        Test::setUp(generator, seed);
+        testRoundTrip(generator.generateProgram());
+    }
+
+    /* Wider fields are used for larger programs */
+    Generator generator;
+    Options   options;
+
+    options.targetBytes = 100000;
+    Test::setUp(generator, 3, options);
+
+    auto large = generator.generateLargeProgram(options.targetBytes, 0);
+
+    testRoundTrip(large);
+    testMalformed(large);
+
+    Test::setUp(generator, 11);
+    testMalformed(generator.generateProgram());
+    testEmpty();
+    return Test::result();
+}
@@ -0,0 +1,86 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <string>
+#include "Canonical.hpp"
+#include "Check.hpp"
+
+using namespace FuzzyTest;
+
+/**
+ * @brief      Hash of the assignment of the literal to the named variable
+ */
+static TreeHash
+hashAssign(const std::string &name,
+           const std::string &literal,
+           const std::string &salt = "cmd")
+{
+    auto variable = Syntax::create(SyntaxKind::Identifier, name);
+    auto block = Syntax::create(
+        SyntaxKind::Block,
+        Syntax::create(SyntaxKind::Declaration,
+                       Syntax::create(SyntaxKind::Type, "uint32_t"),
+                       variable),
+        Syntax::create(SyntaxKind::Assign, variable,
+                       Syntax::create(SyntaxKind::Literal, literal)));
+
+    return hashTree(block, salt);
+}
+
+static void
+testNames()
+{
+    CHECK(hashAssign("abc", "5") == hashAssign("Xy9", "5"));
+    CHECK(hashAssign("abc", "5") != hashAssign("abc", "5", "other"));
+}
+
+static void
+testLiterals()
+{
+    /* The same type and value */
+    CHECK(hashAssign("a", "255") == hashAssign("a", "255"));
+    CHECK(hashAssign("a", "0xFF") == hashAssign("a", "0xff"));
+    CHECK(hashAssign("a", "0377") == hashAssign("a", "0xFF"));
+    CHECK(hashAssign("a", "255u") == hashAssign("a", "255U"));
+    CHECK(hashAssign("a", "5ul") == hashAssign("a", "5LU"));
+    CHECK(hashAssign("a", "5ll") == hashAssign("a", "5LL"));
+    CHECK(hashAssign("a", "0") == hashAssign("a", "0x0"));
+
+    /* Types differ even if values do not */
+    CHECK(hashAssign("a", "255") != hashAssign("a", "0xFF"));
+    CHECK(hashAssign("a", "255") != hashAssign("a", "255u"));
+    CHECK(hashAssign("a", "5l") != hashAssign("a", "5ll"));
+    CHECK(hashAssign("a", "5u") != hashAssign("a", "5ul"));
+    CHECK(hashAssign("a", "4294967295") != hashAssign("a", "0xFFFFFFFF"));
+
+    /* Values differ */
+    CHECK(hashAssign("a", "255") != hashAssign("a", "256"));
+
+    /* Not plain integers are kept as they are */
+    CHECK(hashAssign("a", "5uu") != hashAssign("a", "5u"));
+    CHECK(hashAssign("a", "5lll") != hashAssign("a", "5ll"));
+}
+
+static void
+testPrograms()
+{
+    Generator first;
+    Generator second;
+
+    Test::setUp(first, 11);
+    Test::setUp(second, 11);
+    CHECK(hashTree(first.generateProgram(), "") ==
+          hashTree(second.generateProgram(), ""));
+    CHECK(hashTree(first.generateProgram(), "") !=
+          hashTree(second.generateProgram(), "x"));
+}
+
+int
+main()
+{
+    testNames();
+    testLiterals();
+    testPrograms();
+    return Test::result();
+}
@@ -0,0 +1,71 @@
+/*
+ * FuzzyTest - random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#pragma once
+#include <iostream>
+#include <memory>
+#include "Generator.hpp"
+
+/**
+ * @brief      Check the condition, report it if it does not hold and go on
+ */
+#define CHECK(condition) \
+    FuzzyTest::Test::check((condition), #condition, __FILE__, __LINE__)
+
+namespace FuzzyTest
+{
+namespace Test
+{
+inline int &
+failures()
+{
+    static int count = 0;
+
+    return count;
+}
+
+inline void
+check(bool condition, const char *text, const char *file, int line)
+{
+    if (!condition)
+    {
+        std::cerr << file << ":" << line << ": check failed: " << text
+                  << std::endl;
+        failures()++;
+    }
+}
+
+/**
+ * @brief      Get the exit status of the test
+ *
+ * @return     @c 0 if every check held
+ */
+inline int
+result()
+{
+    return failures() == 0 ? 0 : 1;
+}
+
+/**
+ * @brief      Set up the generator the way the command line does
+ *
+ * @param      generator  The generator
+ * @param      seed       The seed
+ * @param      options    The options
+ *
+ * @return     The random source of the generator
+ */
+inline std::shared_ptr<RandomSource>
+setUp(Generator &generator, unsigned int seed,
+      const Options &options = Options())
+{
+    auto random = std::make_shared<SeededRandomSource>(seed);
+
+    random->next();
+    generator.setOptions(options);
+    generator.setRandomSource(random);
+    return random;
+}
+}
+}
@@ -0,0 +1,160 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "Check.hpp"
+#include "Checkpoint.hpp"
+#include "Corpus.hpp"
+#include "VariantStream.hpp"
+
+using namespace FuzzyTest;
+
+static const char file[] = "CheckpointTest.fzk";
+
+static void
+testRoundTrip()
+{
+    Checkpoint saved;
+    Checkpoint loaded;
+
+    saved.fingerprint = std::string("\0fingerprint\xFF", 13);
+    saved.program = 3;
+    saved.startRandom = std::string(200, '\x80');
+    saved.variant = 1ULL << 40;
+    saved.outputSize = 12345;
+    saved.swapsSize = 678;
+    saved.random = "random";
+    saved.ordering = std::string("\0\1\2", 3);
+    saved.stream = "stream";
+
+    CHECK(saved.save(file));
+    CHECK(loaded.load(file));
+    CHECK(loaded.fingerprint == saved.fingerprint);
+    CHECK(loaded.program == saved.program);
+    CHECK(loaded.startRandom == saved.startRandom);
+    CHECK(loaded.variant == saved.variant);
+    CHECK(loaded.outputSize == saved.outputSize);
+    CHECK(loaded.swapsSize == saved.swapsSize);
+    CHECK(loaded.random == saved.random);
+    CHECK(loaded.ordering == saved.ordering);
+    CHECK(loaded.stream == saved.stream);
+}
+
+static void
+testMalformed()
+{
+    std::ifstream ifs(file, std::ios::binary);
+    std::string   data((std::istreambuf_iterator<char>(ifs)),
+                       std::istreambuf_iterator<char>());
+    Checkpoint    checkpoint;
+
+    ifs.close();
+
+    /* A missing file */
+    std::remove(file);
+    CHECK(!checkpoint.load(file));
+
+    /* Every truncation, trailing data and another version */
+    std::vector<std::string> bad;
+
+    for (size_t size = 0; size < data.size(); ++size)
+        bad.push_back(data.substr(0, size));
+    bad.push_back(data + "x");
+    bad.push_back(data);
+    bad.back()[3]++;
+
+    for (auto &contents : bad)
+    {
+        std::ofstream ofs(file, std::ios::binary | std::ios::trunc);
+
+        ofs << contents;
+        ofs.close();
+        CHECK(!checkpoint.load(file));
+    }
+    std::remove(file);
+}
+
+/**
+ * @brief      Walk the variants, saving the state after @p stop of them into
+ *             a checkpoint, and resume from it in a new generator
+ */
+static void
+testResume(unsigned seed, VariantOrder order, size_t stop)
+{
+    Generator                generator;
+    std::vector<std::string> texts;
+    Checkpoint               checkpoint;
+    Options                  options;
+    std::vector<Syntax *>    nodes;
+
+    options.variantOrder = order;
+
+    auto random = Test::setUp(generator, seed, options);
+    {
+        auto          root = generator.generateProgram();
+        Corpus        corpus(root);
+        VariantStream stream(generator, root, order);
+
+        VariantStream::collectNodes(root, nodes);
+        while (stream.next() && texts.size() < 300)
+        {
+            texts.push_back(root->toString());
+            if (texts.size() != stop)
+                continue;
+
+            checkpoint.variant = stop;
+            corpus.encodeVariant(stop, checkpoint.ordering);
+            stream.saveState(checkpoint.stream, nodes);
+            CHECK(random->saveState(checkpoint.random));
+        }
+    }
+    CHECK(texts.size() > stop);
+    CHECK(checkpoint.save(file));
+
+    /* The tree is generated again and brought to the saved variant */
+    Generator  resumed;
+    Checkpoint loaded;
+    size_t     index;
+
+    CHECK(loaded.load(file));
+    std::remove(file);
+    random = Test::setUp(resumed, seed, options);
+
+    auto          root = resumed.generateProgram();
+    Corpus        corpus(root);
+    VariantStream stream(resumed);
+    const char   *pos = loaded.ordering.data();
+
+    nodes.clear();
+    VariantStream::collectNodes(root, nodes);
+    CHECK(corpus.decodeVariant(pos, pos + loaded.ordering.size(), index));
+    CHECK(index == stop);
+    CHECK(root->toString() == texts[stop - 1]);
+
+    pos = loaded.stream.data();
+    CHECK(stream.restoreState(pos, pos + loaded.stream.size(), nodes));
+    pos = loaded.random.data();
+    CHECK(random->restoreState(pos, pos + loaded.random.size()));
+
+    for (size_t i = stop; i < texts.size(); ++i)
+        CHECK(stream.next() && root->toString() == texts[i]);
+}
+
+int
+main()
+{
+    testRoundTrip();
+    testMalformed();
+    for (auto order : { VariantOrder::Lexicographic, VariantOrder::GrayCode })
+    {
+        testResume(11, order, 1);
+        testResume(11, order, 137);
+        testResume(53, order, 42);
+    }
+    return Test::result();
+}
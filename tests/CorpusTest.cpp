@@ -0,0 +1,205 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <string>
+#include <vector>
+#include "Check.hpp"
+#include "Corpus.hpp"
+#include "Serialization.hpp"
+#include "VariantStream.hpp"
+
+using namespace FuzzyTest;
+
+/* Seeds whose programs have variants with the default options */
+static const unsigned seeds[] = { 8, 11, 53 };
+
+static void
+testRoundTrip(unsigned seed)
+{
+    Generator                generator;
+    std::vector<std::string> texts;
+    std::string              data;
+    size_t                   index;
+
+    Test::setUp(generator, seed);
+
+    auto   root = generator.generateProgram();
+    Corpus corpus(root);
+
+    corpus.encodePrimary(data);
+
+    std::string   primary = root->toString();
+    VariantStream stream(generator, root);
+
+    while (stream.next() && texts.size() < 200)
+    {
+        corpus.encodeVariant(texts.size(), data);
+        texts.push_back(root->toString());
+    }
+    CHECK(!texts.empty());
+
+    /* The corpus is decoded on its own, as --expand does */
+    const char *pos = data.data();
+    const char *end = data.data() + data.size();
+    auto        decoded = Corpus::decodePrimary(pos, end);
+
+    CHECK(decoded != nullptr);
+    if (decoded == nullptr)
+        return;
+    CHECK(decoded->toString() == primary);
+
+    Corpus copy(decoded);
+
+    for (size_t i = 0; i < texts.size(); ++i)
+    {
+        CHECK(copy.decodeVariant(pos, end, index));
+        CHECK(index == i);
+        CHECK(decoded->toString() == texts[i]);
+    }
+    CHECK(pos == end);
+
+    copy.restorePrimary();
+    CHECK(decoded->toString() == primary);
+}
+
+/**
+ * @brief      Get the encoding of the first variant changing a node
+ */
+static std::shared_ptr<Syntax>
+firstVariant(Generator &generator, std::string &data)
+{
+    Test::setUp(generator, 11);
+
+    auto          root = generator.generateProgram();
+    Corpus        corpus(root);
+    VariantStream stream(generator, root);
+
+    CHECK(stream.next());
+    corpus.encodeVariant(0, data);
+    corpus.restorePrimary();
+    return root;
+}
+
+static void
+testMalformed()
+{
+    Generator   generator;
+    std::string data;
+    auto        root = firstVariant(generator, data);
+    std::string primary = root->toString();
+    Corpus      corpus(root);
+    size_t      index;
+
+    /* Every truncation is rejected and leaves the primary tree */
+    for (size_t size = 0; size < data.size(); ++size)
+    {
+        const char *pos = data.data();
+
+        CHECK(!corpus.decodeVariant(pos, data.data() + size, index));
+        CHECK(root->toString() == primary);
+    }
+
+    /* Index, count of changed nodes, node delta, then the positions */
+    const char *pos = data.data();
+    const char *end = data.data() + data.size();
+    uint64_t    value;
+
+    CHECK(getVarint(pos, end, value));
+    CHECK(getVarint(pos, end, value) && value >= 1);
+    CHECK(getVarint(pos, end, value));
+
+    size_t      first = pos - data.data();
+    std::string repeated = data;
+    std::string outside = data;
+
+    /* A position used twice would duplicate a child and drop another */
+    CHECK(getVarint(pos, end, value));
+    repeated[first + 1] = repeated[first];
+    outside[first] = 0x7F;
+
+    for (auto &bad : { repeated, outside })
+    {
+        pos = bad.data();
+        CHECK(!corpus.decodeVariant(pos, bad.data() + bad.size(), index));
+        CHECK(root->toString() == primary);
+    }
+
+    /* A node outside of the tree */
+    std::string node = data;
+
+    node[2] = 0x7F;
+    pos = node.data();
+    CHECK(!corpus.decodeVariant(pos, node.data() + node.size(), index));
+    CHECK(root->toString() == primary);
+
+    /* A corpus of another format */
+    std::string header;
+
+    corpus.encodePrimary(header);
+    header[3]++;
+    pos = header.data();
+    CHECK(Corpus::decodePrimary(pos, header.data() + header.size()) ==
+          nullptr);
+}
+
+/**
+ * @brief      Get the corpus header followed by a block node with a single
+ *             child, whose tag is given
+ */
+static std::string
+blockWithChild(uint64_t child)
+{
+    std::string header;
+    std::string data;
+
+    Corpus(Syntax::create(SyntaxKind::Block, "")).encodePrimary(header);
+
+    /* Magic and version, then the tag, value and children of the block */
+    data.assign(header, 0, 4);
+    putVarint(data, (static_cast<uint64_t>(SyntaxKind::Block) + 1) << 1);
+    putVarint(data, 0);
+    putVarint(data, 1);
+    putVarint(data, child);
+    return data;
+}
+
+static void
+testCycles()
+{
+    /* The child refers to the block itself, which is not finished yet */
+    std::string self = blockWithChild(1);
+    const char *pos = self.data();
+
+    CHECK(Corpus::decodePrimary(pos, self.data() + self.size()) == nullptr);
+
+    /* A null child is fine */
+    std::string null = blockWithChild(0);
+
+    pos = null.data();
+    CHECK(Corpus::decodePrimary(pos, null.data() + null.size()) != nullptr);
+
+    /* Nesting deep enough to overflow the stack while rendering */
+    std::string deep = blockWithChild(0);
+
+    deep.resize(4);
+    for (int i = 0; i < 100000; ++i)
+    {
+        putVarint(deep, (static_cast<uint64_t>(SyntaxKind::Block) + 1) << 1);
+        putVarint(deep, 0);
+        putVarint(deep, 1);
+    }
+    putVarint(deep, 0);
+    pos = deep.data();
+    CHECK(Corpus::decodePrimary(pos, deep.data() + deep.size()) == nullptr);
+}
+
+int
+main()
+{
+    for (auto seed : seeds)
+        testRoundTrip(seed);
+    testMalformed();
+    testCycles();
+    return Test::result();
+}
@@ -0,0 +1,163 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+#include "Check.hpp"
+#include "Corpus.hpp"
+#include "Minimizer.hpp"
+#include "VariantStream.hpp"
+
+using namespace FuzzyTest;
+
+/* Seeds whose programs have variants with the default options */
+static const unsigned seeds[] = { 8, 11, 53 };
+
+/** Node whose children may be permuted with its primary children */
+struct Permuted
+{
+    std::shared_ptr<Syntax>              node;
+    size_t                               start;
+    std::vector<std::shared_ptr<Syntax>> primary;
+};
+
+/**
+ * @brief      Collect the permuted nodes in the order the corpus numbers them
+ */
+static void
+collect(const std::shared_ptr<Syntax> &node, std::vector<Permuted> &out)
+{
+    if (node == nullptr)
+        return;
+
+    int start = Generator::getPermutationStart(node->getKind());
+
+    if (start >= 0 &&
+        node->children().size() >= static_cast<size_t>(start) + 2)
+    {
+        out.push_back({ node, static_cast<size_t>(start),
+                        { node->children().begin() + start,
+                          node->children().end() } });
+    }
+    for (auto &ch : node->children())
+        collect(ch, out);
+}
+
+/**
+ * @brief      List the orderings of @p strength adjacent children the
+ *             current tree has and the primary one does not
+ */
+static std::set<std::vector<size_t>>
+orderings(const std::vector<Permuted> &nodes, size_t strength)
+{
+    std::set<std::vector<size_t>> result;
+
+    for (size_t k = 0; k < nodes.size(); ++k)
+    {
+        auto               &children = nodes[k].node->children();
+        std::vector<size_t> order;
+
+        for (size_t j = nodes[k].start; j < children.size(); ++j)
+        {
+            order.push_back(std::find(nodes[k].primary.begin(),
+                                      nodes[k].primary.end(), children[j]) -
+                            nodes[k].primary.begin());
+        }
+
+        size_t length = std::min(strength, order.size());
+
+        for (size_t i = 0; i + length <= order.size(); ++i)
+        {
+            std::vector<size_t> key(1, k);
+            bool                primary = true;
+
+            for (size_t j = 0; j < length; ++j)
+            {
+                key.push_back(order[i + j]);
+                primary = primary && (j == 0 || order[i + j] == key[j] + 1);
+            }
+            if (!primary)
+                result.insert(key);
+        }
+    }
+    return result;
+}
+
+static void
+testCoverage(unsigned seed, size_t strength)
+{
+    Generator                                  generator;
+    std::vector<std::set<std::vector<size_t>>> found;
+    std::set<std::vector<size_t>>              all;
+    std::set<std::vector<size_t>>              covered;
+    std::vector<Permuted>                      nodes;
+    std::vector<uint32_t>                      order;
+    Minimizer                                  minimizer(strength);
+
+    Test::setUp(generator, seed);
+
+    auto   root = generator.generateProgram();
+    Corpus corpus(root);
+
+    collect(root, nodes);
+    CHECK(nodes.size() == corpus.nodeCount());
+
+    VariantStream stream(generator, root);
+
+    while (stream.next() && found.size() < 300)
+    {
+        found.push_back(orderings(nodes, strength));
+        all.insert(found.back().begin(), found.back().end());
+        minimizer.add(corpus);
+
+        /* The order is reported against the primary children */
+        for (size_t k = 0; k < nodes.size(); ++k)
+        {
+            auto &children = nodes[k].node->children();
+            bool  changed = !std::equal(nodes[k].primary.begin(),
+                                        nodes[k].primary.end(),
+                                        children.begin() + nodes[k].start);
+
+            CHECK(corpus.getOrder(k, order) == changed);
+            for (size_t j = 0; j < order.size(); ++j)
+            {
+                CHECK(order[j] < nodes[k].primary.size() &&
+                      nodes[k].primary[order[j]] ==
+                          children[nodes[k].start + j]);
+            }
+        }
+    }
+    CHECK(!found.empty());
+    CHECK(minimizer.size() == found.size());
+    CHECK(minimizer.orderingCount() == all.size());
+
+    std::vector<size_t> chosen = minimizer.select();
+
+    CHECK(std::is_sorted(chosen.begin(), chosen.end()));
+    CHECK(std::adjacent_find(chosen.begin(), chosen.end()) == chosen.end());
+    CHECK(chosen.size() <= found.size());
+    CHECK(!all.empty() || chosen.empty());
+
+    /* Every ordering of any enumerated variant is in a chosen one */
+    for (auto v : chosen)
+    {
+        CHECK(v < found.size());
+        if (v < found.size())
+            covered.insert(found[v].begin(), found[v].end());
+    }
+    CHECK(covered == all);
+}
+
+int
+main()
+{
+    for (auto seed : seeds)
+    {
+        testCoverage(seed, 2);
+        testCoverage(seed, 3);
+    }
+    return Test::result();
+}
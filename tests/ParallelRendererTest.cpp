@@ -0,0 +1,83 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "Check.hpp"
+#include "ParallelRenderer.hpp"
+#include "VariantStream.hpp"
+
+using namespace FuzzyTest;
+
+static const char file[] = "ParallelRendererTest.c";
+
+/* Thread counts, more of them than pieces to take included */
+static const unsigned threadCounts[] = { 1, 2, 3, 8, 64 };
+
+/* Variants rendered with every renderer */
+static const size_t maxVariants = 10;
+
+static std::string
+readFile()
+{
+    std::ifstream ifs(file, std::ios::binary);
+
+    return std::string(std::istreambuf_iterator<char>(ifs),
+                       std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief      Check both kinds of rendering against Syntax::toString()
+ */
+static void
+checkRendering(ParallelRenderer &renderer, const std::shared_ptr<Syntax> &root)
+{
+    std::string expected = root->toString();
+    std::string out = "stale contents";
+
+    renderer.render(out);
+    CHECK(out == expected);
+
+    CHECK(renderer.renderToFile(file));
+    CHECK(readFile() == expected);
+}
+
+static void
+testThreads(Generator &generator, const std::shared_ptr<Syntax> &root)
+{
+    for (auto threads : threadCounts)
+    {
+        ParallelRenderer renderer(root, threads);
+        VariantStream    stream(generator, root);
+        size_t           i = 0;
+
+        checkRendering(renderer, root);
+
+        /* One renderer and its measured layout serve every variant */
+        while (i++ < maxVariants && stream.next())
+            checkRendering(renderer, root);
+    }
+}
+
+int
+main()
+{
+    Generator generator;
+    Options   options;
+
+    /* Large programs are split into many functions */
+    options.targetBytes = 200000;
+    Test::setUp(generator, 8, options);
+    testThreads(generator,
+                generator.generateLargeProgram(options.targetBytes, 0));
+
+    /* Small ones consist of a few pieces only */
+    Test::setUp(generator, 11);
+    testThreads(generator, generator.generateProgram());
+
+    std::remove(file);
+    return Test::result();
+}
@@ -0,0 +1,146 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <string>
+#include <vector>
+#include "Check.hpp"
+#include "Program.hpp"
+#include "fuzzytest.h"
+
+using namespace FuzzyTest;
+
+/**
+ * @brief      Pull every variant of the program
+ */
+static std::vector<std::string>
+pull(Program &program)
+{
+    std::vector<std::string> texts;
+    std::string              buffer(program.size(), 0);
+    size_t                   size;
+
+    while (program.nextVariant(&buffer[0], buffer.size(), size))
+    {
+        CHECK(size == buffer.size());
+        texts.push_back(buffer);
+    }
+    return texts;
+}
+
+static void
+testRewind(unsigned seed)
+{
+    Options options;
+
+    options.variantLimit = 50;
+
+    Program program(seed, options);
+
+    CHECK(program.isValid());
+
+    std::string primary(program.size(), 0);
+
+    program.render(&primary[0], primary.size());
+
+    auto first = pull(program);
+
+    CHECK(!first.empty());
+
+    /* Every pass repeats the first one */
+    program.rewind();
+    CHECK(pull(program) == first);
+
+    /* So does a pass rewound half way */
+    std::string buffer(primary.size(), 0);
+    size_t      size;
+
+    program.rewind();
+    for (size_t i = 0; i < first.size() / 2; ++i)
+        CHECK(program.nextVariant(&buffer[0], buffer.size(), size));
+    program.rewind();
+    CHECK(pull(program) == first);
+
+    /* Every call of forEachVariant() reports the same variants */
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        size_t i = 0;
+
+        program.forEachVariant(&buffer[0], buffer.size(),
+                               [&](size_t index, size_t) {
+                                   CHECK(index < first.size() &&
+                                         buffer == first[index]);
+                                   i++;
+                                   return false;
+                               });
+        CHECK(i == first.size());
+    }
+
+    /* The tree is left in the primary state */
+    std::string after(primary.size(), 0);
+
+    program.render(&after[0], after.size());
+    CHECK(after == primary);
+
+    /* The C interface walks the same variants */
+    fuzzytest_program *handle = fuzzytest_program_create(seed, 50);
+
+    CHECK(handle != nullptr);
+    for (int pass = 0; pass < 2 && handle != nullptr; ++pass)
+    {
+        size_t i = 0;
+
+        while (fuzzytest_program_next_variant(handle, &buffer[0],
+                                              buffer.size(), &size) != 0)
+        {
+            CHECK(i < first.size() && buffer == first[i]);
+            i++;
+        }
+        CHECK(i == first.size());
+        fuzzytest_program_rewind(handle);
+    }
+    fuzzytest_program_destroy(handle);
+}
+
+static void
+testOptions(unsigned seed)
+{
+    Options   options;
+    Generator generator;
+
+    options.variantLimit = 50;
+    options.variantOrder = VariantOrder::GrayCode;
+
+    /* Variants come in the order the command line writes them */
+    Program program(seed, options);
+
+    CHECK(program.isValid());
+
+    std::vector<std::string> expected;
+
+    Test::setUp(generator, seed, options);
+
+    auto root = generator.generateProgram();
+
+    generator.forEachVariant(
+        root, [&](size_t) { expected.push_back(root->toString()); });
+    CHECK(!expected.empty());
+    CHECK(pull(program) == expected);
+
+    /* Variants chosen after all of them are known are not supported */
+    options.minimizeStrength = 1;
+    CHECK(!Program(seed, options).isValid());
+    options.minimizeStrength = 0;
+    options.shardCount = 2;
+    CHECK(!Program(seed, options).isValid());
+}
+
+int
+main()
+{
+    testRewind(11);
+    testRewind(53);
+    testOptions(11);
+    testOptions(53);
+    return Test::result();
+}
@@ -0,0 +1,121 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <set>
+#include <string>
+#include <vector>
+#include "Check.hpp"
+#include "VariantStream.hpp"
+
+using namespace FuzzyTest;
+
+/* Larger spaces are skipped to keep the test fast */
+static const size_t maxVariants = 50000;
+
+/**
+ * @brief      Get the number of permutations of all permuted nodes together
+ *
+ * @return     The number, or @c 0 if it exceeds maxVariants
+ */
+static size_t
+countVariants(const std::vector<Syntax *> &nodes)
+{
+    size_t count = 1;
+
+    for (auto node : nodes)
+    {
+        int start = Generator::getPermutationStart(node->getKind());
+
+        if (start < 0)
+            continue;
+
+        for (size_t k = 2; k + start <= node->children().size(); ++k)
+        {
+            count *= k;
+            if (count > maxVariants)
+                return 0;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief      Walk the Gray code order and check that every permutation is
+ *             reached exactly once, each by one recorded adjacent swap
+ *
+ * @return     @c true if the program was small enough to be checked
+ */
+static bool
+testGray(unsigned seed)
+{
+    Generator             generator;
+    Options               options;
+    std::vector<Syntax *> nodes;
+
+    options.variantOrder = VariantOrder::GrayCode;
+    Test::setUp(generator, seed, options);
+
+    auto root = generator.generateProgram();
+
+    VariantStream::collectNodes(root, nodes);
+
+    size_t expected = countVariants(nodes);
+
+    if (expected <= 1)
+        return false;
+
+    std::vector<std::vector<std::shared_ptr<Syntax>>> previous;
+    std::set<std::string>                             seen;
+    VariantStream stream(generator, root, options.variantOrder);
+    size_t        node;
+    size_t        position;
+
+    seen.insert(root->toString());
+    for (auto n : nodes)
+        previous.push_back(n->children());
+
+    while (stream.next())
+    {
+        CHECK(seen.insert(root->toString()).second);
+        CHECK(stream.lastSwap(node, position));
+
+        /* Only the two recorded children trade places */
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            auto &children = nodes[i]->children();
+
+            if (i != node)
+            {
+                CHECK(children == previous[i]);
+                continue;
+            }
+
+            CHECK(position + 1 < children.size());
+            std::swap(previous[i][position], previous[i][position + 1]);
+            CHECK(children == previous[i]);
+            previous[i] = children;
+        }
+
+        if (seen.size() > expected)
+            break;
+    }
+
+    /* The primary program is one of the permutations */
+    CHECK(seen.size() == expected);
+    CHECK(stream.count() == expected - 1);
+    return true;
+}
+
+int
+main()
+{
+    size_t checked = 0;
+
+    for (unsigned seed = 1; seed <= 200; ++seed)
+        checked += testGray(seed) ? 1 : 0;
+
+    /* Make sure the seeds still produce programs worth checking */
+    CHECK(checked >= 5);
+    return Test::result();
+}
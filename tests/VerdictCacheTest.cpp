@@ -0,0 +1,119 @@
+/*
+ * FuzzyTest - simple random program generator.
+ * (C) Maxim Menshikov 2019-2020
+ */
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "Check.hpp"
+#include "VerdictCache.hpp"
+
+using namespace FuzzyTest;
+
+static const char file[] = "VerdictCacheTest.fzv";
+
+static TreeHash
+makeHash(uint64_t value)
+{
+    TreeHash hash;
+
+    hash.high = value * 0x9E3779B97F4A7C15ULL;
+    hash.low = value;
+    return hash;
+}
+
+static std::string
+readFile()
+{
+    std::ifstream ifs(file, std::ios::binary);
+
+    return std::string(std::istreambuf_iterator<char>(ifs),
+                       std::istreambuf_iterator<char>());
+}
+
+static void
+writeFile(const std::string &data)
+{
+    std::ofstream ofs(file, std::ios::binary | std::ios::trunc);
+
+    ofs << data;
+}
+
+static void
+testRoundTrip()
+{
+    int status;
+
+    std::remove(file);
+    {
+        VerdictCache cache;
+
+        CHECK(cache.open(file));
+        CHECK(cache.size() == 0);
+        for (int i = 0; i < 100; ++i)
+            CHECK(cache.insert(makeHash(i), i - 50));
+    }
+
+    VerdictCache cache;
+
+    CHECK(cache.open(file));
+    CHECK(cache.size() == 100);
+    for (int i = 0; i < 100; ++i)
+        CHECK(cache.find(makeHash(i), status) && status == i - 50);
+    CHECK(!cache.find(makeHash(100), status));
+}
+
+static void
+testTruncated()
+{
+    std::string data = readFile();
+    int         status;
+
+    /* A torn record is dropped and the next one takes its place */
+    writeFile(data.substr(0, data.size() - 7));
+    {
+        VerdictCache cache;
+
+        CHECK(cache.open(file));
+        CHECK(cache.size() == 99);
+        CHECK(!cache.find(makeHash(99), status));
+        CHECK(cache.insert(makeHash(1000), 7));
+    }
+    {
+        VerdictCache cache;
+
+        CHECK(cache.open(file));
+        CHECK(cache.size() == 100);
+        CHECK(cache.find(makeHash(1000), status) && status == 7);
+        CHECK(cache.find(makeHash(98), status) && status == 48);
+    }
+
+    /* Only the header is left */
+    writeFile(data.substr(0, 4));
+    {
+        VerdictCache cache;
+
+        CHECK(cache.open(file));
+        CHECK(cache.size() == 0);
+    }
+
+    /* A torn header, another format or another version */
+    for (auto bad : { data.substr(0, 3), std::string("FZC\x02"),
+                      std::string("FZV\x01") })
+    {
+        VerdictCache cache;
+
+        writeFile(bad);
+        CHECK(!cache.open(file));
+    }
+    std::remove(file);
+}
+
+int
+main()
+{
+    testRoundTrip();
+    testTruncated();
+    return Test::result();
+}